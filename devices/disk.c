@@ -86,7 +86,7 @@ static void reset_channel(struct channel *);
 static bool check_device_type(struct disk *);
 static void identify_ata_device(struct disk *);
 
-static void select_sector(struct disk *, disk_sector_t);
+static void select_sector(struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command(struct channel *, uint8_t command);
 static void input_sector(struct channel *, void *);
 static void output_sector(struct channel *, const void *);
@@ -205,48 +205,75 @@ disk_sector_t disk_size(struct disk *d) {
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 void disk_read(struct disk *d, disk_sector_t sec_no, void *buffer) {
+    disk_read_multi(d, sec_no, buffer, 1);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   DISK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void disk_write(struct disk *d, disk_sector_t sec_no, const void *buffer) {
+    disk_write_multi(d, sec_no, buffer, 1);
+}
+
+/* Reads CNT consecutive sectors starting at SEC_NO from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  The whole run is transferred with a single READ SECTOR
+   command, so the device is selected and the command issued
+   only once.  CNT must be between 1 and DISK_MULTI_MAX. */
+void disk_read_multi(struct disk *d, disk_sector_t sec_no, void *buffer, size_t cnt) {
     struct channel *c;
+    size_t i;
 
     ASSERT(d != NULL);
     ASSERT(buffer != NULL);
+    ASSERT(cnt > 0 && cnt <= DISK_MULTI_MAX);
 
     c = d->channel;
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
+    select_sector(d, sec_no, cnt);
     issue_pio_command(c, CMD_READ_SECTOR_RETRY);
-    sema_down(&c->completion_wait);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no);
-    input_sector(c, buffer);
-    d->read_cnt++;
+    for (i = 0; i < cnt; i++) {
+        /* The device interrupts once per sector when its data is ready. */
+        sema_down(&c->completion_wait);
+        if (!wait_while_busy(d))
+            PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no + (disk_sector_t)i);
+        input_sector(c, (uint8_t *)buffer + i * DISK_SECTOR_SIZE);
+    }
+    d->read_cnt += cnt;
     lock_release(&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   DISK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
-   Internally synchronizes accesses to disks, so external
-   per-disk locking is unneeded. */
-void disk_write(struct disk *d, disk_sector_t sec_no, const void *buffer) {
+/* Writes CNT consecutive sectors starting at SEC_NO to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes,
+   with a single WRITE SECTOR command.  Returns after the disk
+   has acknowledged receiving all of the data.
+   CNT must be between 1 and DISK_MULTI_MAX. */
+void disk_write_multi(struct disk *d, disk_sector_t sec_no, const void *buffer, size_t cnt) {
     struct channel *c;
+    size_t i;
 
     ASSERT(d != NULL);
     ASSERT(buffer != NULL);
+    ASSERT(cnt > 0 && cnt <= DISK_MULTI_MAX);
 
     c = d->channel;
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
+    select_sector(d, sec_no, cnt);
     issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
-    output_sector(c, buffer);
-    sema_down(&c->completion_wait);
-    d->write_cnt++;
+    for (i = 0; i < cnt; i++) {
+        /* The device asks for each sector with DRQ and interrupts
+           after it has taken it. */
+        if (!wait_while_busy(d))
+            PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no + (disk_sector_t)i);
+        output_sector(c, (const uint8_t *)buffer + i * DISK_SECTOR_SIZE);
+        sema_down(&c->completion_wait);
+    }
+    d->write_cnt += cnt;
     lock_release(&c->lock);
 }
 
-/* Disk detection and identification. */
-
 static void print_ata_string(char *string, size_t size);
 
 /* Resets an ATA channel and waits for any devices present on it
@@ -389,16 +416,18 @@ static void print_ata_string(char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct disk *d, disk_sector_t sec_no) {
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.)  A count register of
+   0 means 256 sectors. */
+static void select_sector(struct disk *d, disk_sector_t sec_no, size_t cnt) {
     struct channel *c = d->channel;
 
-    ASSERT(sec_no < d->capacity);
-    ASSERT(sec_no < (1UL << 28));
+    ASSERT(cnt > 0 && cnt <= DISK_MULTI_MAX);
+    ASSERT(sec_no + cnt <= d->capacity);
+    ASSERT(sec_no + cnt <= (1UL << 28));
 
     select_device_wait(d);
-    outb(reg_nsect(c), 1);
+    outb(reg_nsect(c), cnt == DISK_MULTI_MAX ? 0 : cnt);
     outb(reg_lbal(c), sec_no);
     outb(reg_lbam(c), sec_no >> 8);
     outb(reg_lbah(c), (sec_no >> 16));
@@ -0,0 +1,243 @@
+/* defrag.c: Background defragmenter for FAT cluster chains. */
+
+#include "filesys/defrag.h"
+
+#include <debug.h>
+#include <stdio.h>
+
+#include "devices/timer.h"
+#include "filesys/directory.h"
+#include "filesys/fat.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "filesys/volume.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+
+/* 전체 scan 주기 */
+#define DEFRAG_INTERVAL (10 * TIMER_FREQ)
+/* Directory entry 하나를 검사한 뒤 쉬는 tick */
+#define DEFRAG_SCAN_DELAY 1
+/* 한 tick 동안 복사할 수 있는 cluster 수 */
+#define DEFRAG_COPY_RATE 16
+/* 인접하지 않은 link가 이 비율(%) 이상인 파일만 옮긴다. */
+#define DEFRAG_THRESHOLD 25
+/* 따라 내려갈 최대 directory 깊이 (kernel stack 보호) */
+#define DEFRAG_MAX_DEPTH 8
+
+/* Scan 한 번의 결과. frags / links 가 fragmentation. */
+struct defrag_stat {
+    size_t links;  /* 파일 chain의 link 수 (cluster 수 - 1) */
+    size_t before; /* 옮기기 전 인접하지 않은 link 수 */
+    size_t after;  /* 옮긴 후 인접하지 않은 link 수 */
+    size_t files;  /* 옮긴 파일 수 */
+};
+
+static int first_pct = -1; /* 첫 scan에서 측정한 fragmentation (%) */
+static int last_pct = -1;  /* 마지막 scan 후 fragmentation (%) */
+static size_t moved_files;
+static size_t moved_clusters;
+
+/* filesys_lock이 보호한다. */
+static bool stopped;            /* defrag_done 이후 true */
+static bool scanning;           /* defragd가 directory를 열어 둔 채 scan 중 */
+static struct condition idle;   /* scanning == false */
+
+static void defragd(void *aux);
+
+/** Project 4: Defrag - 가장 낮은 priority로 defragd 시작 */
+void defrag_init(void) {
+    cond_init(&idle);
+    thread_create("defragd", PRI_MIN, defragd, NULL);
+}
+
+/** Project 4: Defrag - journal과 FAT을 내리기 전에 부른다.
+ * 진행 중인 scan이 열어 둔 directory를 닫고 끝날 때까지 기다린 뒤, 이후로는 scan하지 않게 한다. */
+void defrag_done(void) {
+    lock_acquire(&filesys_lock);
+    stopped = true;
+    while (scanning)
+        cond_wait(&idle, &filesys_lock);
+    lock_release(&filesys_lock);
+}
+
+static int defrag_pct(size_t frags, size_t links) {
+    return links == 0 ? 0 : frags * 100 / links;
+}
+
+/** Project 4: Defrag - 종료 시 fragmentation 변화 출력 */
+void defrag_print_stats(void) {
+    if (first_pct < 0)
+        return;
+
+    printf("Defrag: %zu files (%zu clusters) moved, fragmentation %d%% -> %d%%\n", moved_files, moved_clusters,
+           first_pct, last_pct);
+}
+
+/* V의 START부터 chain을 따라가며 cluster 수를 *LEN에, 인접하지 않은 link 수를 리턴 */
+static size_t chain_frags(struct volume *v, cluster_t start, size_t *len) {
+    cluster_t clst = start;
+    size_t frags = 0;
+
+    *len = 0;
+    while (clst != 0 && clst != EOChain) {
+        cluster_t next = fat_get(v, clst);
+
+        if (next != EOChain && next != clst + 1)
+            frags++;
+        (*len)++;
+        clst = next;
+    }
+    return frags;
+}
+
+/* INODE의 LEN개짜리 chain을 연속된 빈 cluster로 복사하고 FAT과 inode_disk.start를
+ * 하나의 transaction으로 바꾼다. filesys_lock을 잡은 상태로 호출. */
+static bool defrag_file(struct inode *inode, size_t len) {
+    struct volume *v = inode_get_volume(inode);
+    cluster_t old = sector_to_cluster(v, inode_get_start(inode));
+    cluster_t run, clst;
+    uint8_t *buf;
+    size_t i;
+
+    /* 복사하는 동안 disk I/O에서 잠드는 사이 다른 thread가 run 안의 cluster를 가져가지 않도록
+     * 먼저 새 chain으로 잡아 둔다. 옮기기 전에 죽으면 cluster가 새기만 한다. */
+    journal_begin(v);
+    run = fat_find_free_run(v, len);
+    for (i = 0; run != 0 && i < len; i++)
+        fat_put(v, run + i, i + 1 < len ? run + i + 1 : EOChain);
+    journal_end(v);
+
+    if (run == 0)
+        return false;
+
+    buf = malloc(DISK_SECTOR_SIZE);
+    if (buf == NULL)
+        goto release;
+
+    /* 새 위치에 data 복사. 아직 inode는 예전 chain을 가리키므로 중간에 죽어도 안전 */
+    for (clst = old, i = 0; i < len; clst = fat_get(v, clst), i++) {
+        volume_read(v, cluster_to_sector(v, clst), buf);
+        journal_revoke(v, cluster_to_sector(v, run + i));
+        if (!volume_write(v, cluster_to_sector(v, run + i), buf)) {  // tmpfs memory 부족
+            free(buf);
+            goto release;
+        }
+    }
+    free(buf);
+
+    journal_begin(v);
+    inode_set_start(inode, cluster_to_sector(v, run));
+
+    for (clst = old; clst != EOChain;) {
+        cluster_t next = fat_get(v, clst);
+        fat_put(v, clst, 0);
+        clst = next;
+    }
+    journal_end(v);
+
+    return true;
+
+release:  // 잡아 둔 run을 돌려준다.
+    journal_begin(v);
+    fat_remove_chain(v, run, 0);
+    journal_end(v);
+    return false;
+}
+
+/* DIR 아래 파일들을 검사하고 많이 조각난 파일을 옮긴다. */
+static void defrag_dir(struct dir *dir, int depth, struct defrag_stat *st) {
+    char name[NAME_MAX + 1];
+
+    lock_acquire(&filesys_lock);
+    while (!stopped && dir_readdir(dir, name)) {
+        struct inode *inode = NULL;
+
+        if (!dir_lookup(dir, name, &inode))
+            continue;
+
+        if (inode_get_type(inode) == DIR_TYPE) {
+            if (depth < DEFRAG_MAX_DEPTH) {
+                struct dir *sub = dir_open(inode);
+
+                lock_release(&filesys_lock);
+                defrag_dir(sub, depth + 1, st);
+                lock_acquire(&filesys_lock);
+                dir_close(sub);
+            } else
+                inode_close(inode);
+            continue;
+        }
+
+        if (inode_get_type(inode) == FILE_TYPE) {
+            size_t len;
+            struct volume *v = inode_get_volume(inode);
+            size_t frags = chain_frags(v, sector_to_cluster(v, inode_get_start(inode)), &len);
+            size_t copied = 0;
+
+            if (len > 1) {
+                st->links += len - 1;
+                st->before += frags;
+
+                /* 다른 곳에서 열려 있거나 clone과 cluster를 공유하는 파일은 건드리지 않는다. */
+                if (defrag_pct(frags, len - 1) >= DEFRAG_THRESHOLD && inode_open_cnt(inode) == 1 &&
+                    !fat_chain_shared(v, sector_to_cluster(v, inode_get_start(inode))) && defrag_file(inode, len)) {
+                    copied = len;
+                    st->files++;
+                    moved_clusters += len;
+                } else
+                    st->after += frags;
+            }
+            inode_close(inode);
+
+            if (copied > 0) {
+                lock_release(&filesys_lock);
+                timer_sleep(copied / DEFRAG_COPY_RATE + 1);
+                lock_acquire(&filesys_lock);
+            }
+            continue;
+        }
+
+        inode_close(inode);
+    }
+    lock_release(&filesys_lock);
+
+    timer_sleep(DEFRAG_SCAN_DELAY);
+}
+
+/* Defragmenter daemon. */
+static void defragd(void *aux UNUSED) {
+    while (true) {
+        struct defrag_stat st = {0};
+        struct dir *root;
+
+        timer_sleep(DEFRAG_INTERVAL);
+
+        lock_acquire(&filesys_lock);
+        if (stopped) {
+            lock_release(&filesys_lock);
+            return;
+        }
+        root = dir_open_root();
+        scanning = root != NULL;
+        lock_release(&filesys_lock);
+        if (root == NULL)
+            continue;
+
+        defrag_dir(root, 0, &st);
+
+        lock_acquire(&filesys_lock);
+        dir_close(root);
+        scanning = false;
+        cond_broadcast(&idle, &filesys_lock);
+        lock_release(&filesys_lock);
+
+        if (first_pct < 0)
+            first_pct = defrag_pct(st.before, st.links);
+        last_pct = defrag_pct(st.after, st.links);
+        moved_files += st.files;
+    }
+}
@@ -7,6 +7,7 @@
 #include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/volume.h"
 #include "threads/malloc.h"
 
 /* A directory. */
@@ -24,8 +25,8 @@ struct dir_entry {
 
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
-bool dir_create(disk_sector_t sector, size_t entry_cnt) {
-    return inode_create(sector, entry_cnt * sizeof(struct dir_entry), DIR_TYPE);
+bool dir_create(struct volume *v, disk_sector_t sector, size_t entry_cnt) {
+    return inode_create(v, sector, entry_cnt * sizeof(struct dir_entry), DIR_TYPE);
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -47,7 +48,7 @@ struct dir *dir_open(struct inode *inode) {
 /* Opens the root directory and returns a directory for it.
  * Return true if successful, false on failure. */
 struct dir *dir_open_root(void) {
-    return dir_open(inode_open(ROOT_DIR_SECTOR));
+    return dir_open(inode_open(root_volume, ROOT_DIR_SECTOR));
 }
 #endif
 
@@ -105,7 +106,7 @@ bool dir_lookup(const struct dir *dir, const char *name, struct inode **inode) {
     ASSERT(name != NULL);
 
     if (lookup(dir, name, &e, NULL))
-        *inode = inode_open(e.inode_sector);
+        *inode = inode_open(inode_get_volume(dir->inode), e.inode_sector);
     else
         *inode = NULL;
 
@@ -173,10 +174,14 @@ bool dir_remove(struct dir *dir, const char *name) {
         goto done;
 
     /* Open inode. */
-    inode = inode_open(e.inode_sector);
+    inode = inode_open(inode_get_volume(dir->inode), e.inode_sector);
     if (inode == NULL)
         goto done;
 
+    /** Project 4: Mount - mount point는 지울 수 없다. */
+    if (volume_mounted_on(inode) != NULL)
+        goto done;
+
     /* Erase directory entry. */
     e.in_use = false;
     if (inode_write_at(dir->inode, &e, sizeof e, ofs) != sizeof e)
@@ -212,7 +217,12 @@ bool dir_readdir(struct dir *dir, char name[NAME_MAX + 1]) {
 /** #Project 4: File System - Opens the root directory and returns a directory for it.
  * Return true if successful, false on failure. */
 struct dir *dir_open_root(void) {
-    return dir_open(inode_open(cluster_to_sector(ROOT_DIR_CLUSTER)));
+    return dir_open_volume(root_volume);
+}
+
+/** Project 4: Mount - V의 root directory를 연다. */
+struct dir *dir_open_volume(struct volume *v) {
+    return dir_open(inode_open(v, cluster_to_sector(v, ROOT_DIR_CLUSTER)));
 }
 
 /** #Project 4: File System - Searches DIR for a file with the given NAME
@@ -221,15 +231,30 @@ struct dir *dir_open_root(void) {
  * a null pointer.  The caller must close *INODE. */
 bool dir_lookup(const struct dir *dir, const char *name, struct inode **inode) {
     struct dir_entry e;
+    struct volume *v;
 
     ASSERT(dir != NULL);
     ASSERT(name != NULL);
 
+    v = inode_get_volume(dir->inode);
+
+    /** Project 4: Mount - mount된 volume의 root에서 ".."는 mount point의 상위 directory */
+    if (!strcmp(name, "..") && v->mount_point != NULL && volume_is_root_inode(dir->inode)) {
+        struct dir mount_dir = {.inode = v->mount_point, .pos = 0};
+        return dir_lookup(&mount_dir, name, inode);
+    }
+
     if (lookup(dir, name, &e, NULL))
-        *inode = inode_open(e.inode_sector);
+        *inode = inode_open(v, e.inode_sector);
     else
         *inode = NULL;
 
+    /** Project 4: Mount - mount point면 붙어 있는 volume의 root로 넘어간다. */
+    if (*inode != NULL && (v = volume_mounted_on(*inode)) != NULL) {
+        inode_close(*inode);
+        *inode = inode_open(v, cluster_to_sector(v, ROOT_DIR_CLUSTER));
+    }
+
     return *inode != NULL;
 }
 
@@ -253,10 +278,14 @@ bool dir_remove(struct dir *dir, const char *name) {
         goto done;
 
     /* Open inode. */
-    inode = inode_open(e.inode_sector);
+    inode = inode_open(inode_get_volume(dir->inode), e.inode_sector);
     if (inode == NULL)
         goto done;
 
+    /** Project 4: Mount - mount point는 지울 수 없다. */
+    if (volume_mounted_on(inode) != NULL)
+        goto done;
+
     /* Erase directory entry. */
     e.in_use = false;
     if (inode_write_at(dir->inode, &e, sizeof e, ofs) != sizeof e)
@@ -1,10 +1,13 @@
 #include "filesys/fat.h"
 
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/journal.h"
+#include "filesys/volume.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
 
@@ -16,6 +19,12 @@ struct fat_boot {
     unsigned int fat_start;
     unsigned int fat_sectors; /* Size of FAT in sectors. */
     unsigned int root_dir_cluster;
+    /** Project 4: Journaling */
+    unsigned int journal_start;
+    unsigned int journal_sectors; /* 0: journal 없음 */
+    /** Project 4: Clone */
+    unsigned int refcnt_start;
+    unsigned int refcnt_sectors; /* 0: clone 불가 */
 };
 
 /* FAT FS */
@@ -26,33 +35,55 @@ struct fat_fs {
     disk_sector_t data_start;
     cluster_t last_clst;
     struct lock write_lock;
+    /** Project 4: Clone - cluster별 추가 참조 수. 0이면 한 file만 사용 */
+    uint8_t *refcnt;
+    size_t shared_cnt; /* refcnt가 0이 아닌 cluster 수 */
 };
 
-static struct fat_fs *fat_fs;
+void fat_boot_create(struct volume *);
+void fat_fs_init(struct volume *);
+static void refcnt_put(struct volume *, cluster_t, uint8_t);
 
-void fat_boot_create(void);
-void fat_fs_init(void);
+/* 참조 수 table. refcnt 영역이 없는 예전 disk여도 모든 cluster를 index 할 수 있게 잡는다. */
+static uint8_t *refcnt_alloc(struct fat_fs *fat_fs) {
+    size_t sectors = DIV_ROUND_UP(fat_fs->fat_length, DISK_SECTOR_SIZE);
 
-void fat_init(void) {
-    fat_fs = calloc(1, sizeof(struct fat_fs));
+    if (sectors < fat_fs->bs.refcnt_sectors)
+        sectors = fat_fs->bs.refcnt_sectors;
+    return calloc(sectors, DISK_SECTOR_SIZE);
+}
+
+/** Project 4: Mount - V의 boot sector를 읽는다. 이미 FAT으로 format된 disk면 true. */
+bool fat_init(struct volume *v) {
+    struct fat_fs *fat_fs = calloc(1, sizeof(struct fat_fs));
     if (fat_fs == NULL)
         PANIC("FAT init failed");
+    v->fat_fs = fat_fs;
 
     // Read boot sector from the disk
     unsigned int *bounce = malloc(DISK_SECTOR_SIZE);
     if (bounce == NULL)
         PANIC("FAT init failed");
-    disk_read(filesys_disk, FAT_BOOT_SECTOR, bounce);
+    volume_read(v, FAT_BOOT_SECTOR, bounce);
     memcpy(&fat_fs->bs, bounce, sizeof(fat_fs->bs));
     free(bounce);
 
     // Extract FAT info
-    if (fat_fs->bs.magic != FAT_MAGIC)
-        fat_boot_create();
-    fat_fs_init();
+    bool formatted = fat_fs->bs.magic == FAT_MAGIC;
+    if (!formatted)
+        fat_boot_create(v);
+    fat_fs_init(v);
+
+    return formatted;
 }
 
-void fat_open(void) {
+void fat_open(struct volume *v) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
+    /** Project 4: Journaling - FAT을 읽기 전에 commit된 metadata를 먼저 복구 */
+    journal_init(v, fat_fs->bs.journal_start, fat_fs->bs.journal_sectors);
+
+    free(fat_fs->fat);  // format 직후라면 fat_create가 만든 table
     fat_fs->fat = calloc(fat_fs->fat_length, sizeof(cluster_t));
     if (fat_fs->fat == NULL)
         PANIC("FAT load failed");
@@ -65,27 +96,42 @@ void fat_open(void) {
     for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
         bytes_left = fat_size_in_bytes - bytes_read;
         if (bytes_left >= DISK_SECTOR_SIZE) {
-            disk_read(filesys_disk, fat_fs->bs.fat_start + i, buffer + bytes_read);
+            volume_read(v, fat_fs->bs.fat_start + i, buffer + bytes_read);
             bytes_read += DISK_SECTOR_SIZE;
         } else {
             uint8_t *bounce = malloc(DISK_SECTOR_SIZE);
             if (bounce == NULL)
                 PANIC("FAT load failed");
-            disk_read(filesys_disk, fat_fs->bs.fat_start + i, bounce);
+            volume_read(v, fat_fs->bs.fat_start + i, bounce);
             memcpy(buffer + bytes_read, bounce, bytes_left);
             bytes_read += bytes_left;
             free(bounce);
         }
     }
+
+    /** Project 4: Clone - 공유 cluster의 참조 수 table */
+    free(fat_fs->refcnt);
+    fat_fs->refcnt = refcnt_alloc(fat_fs);
+    if (fat_fs->refcnt == NULL)
+        PANIC("FAT load failed");
+    for (unsigned i = 0; i < fat_fs->bs.refcnt_sectors; i++)
+        volume_read(v, fat_fs->bs.refcnt_start + i, fat_fs->refcnt + i * DISK_SECTOR_SIZE);
+
+    fat_fs->shared_cnt = 0;
+    for (cluster_t clst = 0; clst < fat_fs->fat_length; clst++)
+        if (fat_fs->refcnt[clst] > 0)
+            fat_fs->shared_cnt++;
 }
 
-void fat_close(void) {
+void fat_close(struct volume *v) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
     // Write FAT boot sector
     uint8_t *bounce = calloc(1, DISK_SECTOR_SIZE);
     if (bounce == NULL)
         PANIC("FAT close failed");
     memcpy(bounce, &fat_fs->bs, sizeof(fat_fs->bs));
-    disk_write(filesys_disk, FAT_BOOT_SECTOR, bounce);
+    volume_write(v, FAT_BOOT_SECTOR, bounce);
     free(bounce);
 
     // Write FAT directly to the disk
@@ -96,50 +142,80 @@ void fat_close(void) {
     for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
         bytes_left = fat_size_in_bytes - bytes_wrote;
         if (bytes_left >= DISK_SECTOR_SIZE) {
-            disk_write(filesys_disk, fat_fs->bs.fat_start + i, buffer + bytes_wrote);
+            volume_write(v, fat_fs->bs.fat_start + i, buffer + bytes_wrote);
             bytes_wrote += DISK_SECTOR_SIZE;
         } else {
             bounce = calloc(1, DISK_SECTOR_SIZE);
             if (bounce == NULL)
                 PANIC("FAT close failed");
             memcpy(bounce, buffer + bytes_wrote, bytes_left);
-            disk_write(filesys_disk, fat_fs->bs.fat_start + i, bounce);
+            volume_write(v, fat_fs->bs.fat_start + i, bounce);
             bytes_wrote += bytes_left;
             free(bounce);
         }
     }
+
+    /** Project 4: Clone */
+    for (unsigned i = 0; i < fat_fs->bs.refcnt_sectors; i++)
+        volume_write(v, fat_fs->bs.refcnt_start + i, fat_fs->refcnt + i * DISK_SECTOR_SIZE);
 }
 
-void fat_create(void) {
+/** Project 4: Mount - fat_close 후 V의 FAT 상태를 해제 */
+void fat_destroy(struct volume *v) {
+    if (v->fat_fs == NULL)
+        return;
+
+    free(v->fat_fs->fat);
+    free(v->fat_fs->refcnt);
+    free(v->fat_fs);
+    v->fat_fs = NULL;
+}
+
+void fat_create(struct volume *v) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
     // Create FAT boot
-    fat_boot_create();
-    fat_fs_init();
+    fat_boot_create(v);
+    fat_fs_init(v);
 
     // Create FAT table
     fat_fs->fat = calloc(fat_fs->fat_length, sizeof(cluster_t));
-    if (fat_fs->fat == NULL)
+    fat_fs->refcnt = refcnt_alloc(fat_fs);
+    if (fat_fs->fat == NULL || fat_fs->refcnt == NULL)
         PANIC("FAT creation failed");
 
+    journal_format(v, fat_fs->bs.journal_start, fat_fs->bs.journal_sectors);
+
     // Set up ROOT_DIR_CLST
-    fat_put(ROOT_DIR_CLUSTER, EOChain);
+    fat_put(v, ROOT_DIR_CLUSTER, EOChain);
 
     // Fill up ROOT_DIR_CLUSTER region with 0
     uint8_t *buf = calloc(1, DISK_SECTOR_SIZE);
     if (buf == NULL)
         PANIC("FAT create failed due to OOM");
-    disk_write(filesys_disk, cluster_to_sector(ROOT_DIR_CLUSTER), buf);
+    volume_write(v, cluster_to_sector(v, ROOT_DIR_CLUSTER), buf);
     free(buf);
 }
 
-void fat_boot_create(void) {
-    unsigned int fat_sectors = (disk_size(filesys_disk) - 1) / (DISK_SECTOR_SIZE / sizeof(cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+void fat_boot_create(struct volume *v) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
+    unsigned int fat_sectors = (volume_size(v) - 1) / (DISK_SECTOR_SIZE / sizeof(cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+    /** Project 4: Journaling - 작은 disk와 tmpfs에는 journal을 두지 않는다. */
+    unsigned int journal_sectors = v->ram == NULL && volume_size(v) >= JOURNAL_SECTORS * 8 ? JOURNAL_SECTORS : 0;
+    /** Project 4: Clone - cluster당 1 byte */
+    unsigned int refcnt_sectors = DIV_ROUND_UP(volume_size(v), DISK_SECTOR_SIZE);
     fat_fs->bs = (struct fat_boot){
         .magic = FAT_MAGIC,
         .sectors_per_cluster = SECTORS_PER_CLUSTER,
-        .total_sectors = disk_size(filesys_disk),
+        .total_sectors = volume_size(v),
         .fat_start = 1,
         .fat_sectors = fat_sectors,
         .root_dir_cluster = ROOT_DIR_CLUSTER,
+        .journal_start = 1 + fat_sectors + refcnt_sectors,
+        .journal_sectors = journal_sectors,
+        .refcnt_start = 1 + fat_sectors,
+        .refcnt_sectors = refcnt_sectors,
     };
 }
 
@@ -147,49 +223,71 @@ void fat_boot_create(void) {
  * 당신은 fat_fs의 fat_length와 data_start 필드를 초기화해야 합니다. fat_length는 파일시스템에 몇 개의 클러스터가 있는지에 대한 정보를 저장하고,
  * data_start는 어떤 섹터에서 파일 저장을 시작할 수 있는지에 대한 정보를 저장합니다. 당신은 어쩌면 fat_fs->bs 에 저장된 값을 이용하고 싶어질 수도
  * 있습니다. 또한, 이 함수에서 다른 유용한 데이터를 초기화하고 싶어질수도 있습니다. */
-void fat_fs_init(void) {
+void fat_fs_init(struct volume *v) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
     /* TODO: Your code goes here. */
-    fat_fs->data_start = fat_fs->bs.fat_sectors + fat_fs->bs.fat_start;
-    fat_fs->fat_length = disk_size(filesys_disk) - fat_fs->bs.fat_sectors - 1;
+    fat_fs->data_start = fat_fs->bs.fat_sectors + fat_fs->bs.fat_start + fat_fs->bs.refcnt_sectors + fat_fs->bs.journal_sectors;
+    fat_fs->fat_length = volume_size(v) - fat_fs->data_start;
 }
 
 /*----------------------------------------------------------------------------*/
 /* FAT handling                                                               */
 /*----------------------------------------------------------------------------*/
 /** Project 4: Filesys */
-cluster_t get_empty_cluster(void) {
+cluster_t get_empty_cluster(struct volume *v) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
     cluster_t clst = fat_fs->bs.root_dir_cluster + 1;
     cluster_t fat_length = fat_fs->fat_length;
 
     for (clst; clst < fat_length; clst++) {
-        if (fat_get(clst) == 0)
+        if (fat_get(v, clst) == 0)
             break;
     }
 
     return clst;
 }
 
+/** Project 4: Defrag - CNT개의 연속된 빈 cluster 중 첫 번째를 찾는다. 없으면 0. */
+cluster_t fat_find_free_run(struct volume *v, size_t cnt) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
+    cluster_t clst = fat_fs->bs.root_dir_cluster + 1;
+    size_t run = 0;
+
+    for (; clst < fat_fs->fat_length; clst++) {
+        run = fat_get(v, clst) == 0 ? run + 1 : 0;
+        if (run == cnt)
+            return clst - cnt + 1;
+    }
+
+    return 0;
+}
+
 /* Add a cluster to the chain.
  * If CLST is 0, start a new chain.
  * Returns 0 if fails to allocate a new cluster. */
-cluster_t fat_create_chain(cluster_t clst) {
+cluster_t fat_create_chain(struct volume *v, cluster_t clst) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
     /* TODO: Your code goes here. */
-    cluster_t empty_clst = get_empty_cluster();
+    cluster_t empty_clst = get_empty_cluster(v);
 
     if (empty_clst >= fat_fs->fat_length)  // empty cluster가 없을 때
         return 0;
 
-    fat_put(empty_clst, EOChain);
+    fat_put(v, empty_clst, EOChain);
 
     if (clst == 0)  // empty cluster에 새로운 cluster 생성
         goto done;
 
     cluster_t tmp = clst;
 
-    while (fat_get(tmp) != EOChain)
-        tmp = fat_get(tmp);
+    while (fat_get(v, tmp) != EOChain)
+        tmp = fat_get(v, tmp);
 
-    fat_put(tmp, empty_clst);  // 기존 cluster chain의 마지막에 cluster 추가
+    fat_put(v, tmp, empty_clst);  // 기존 cluster chain의 마지막에 cluster 추가
 
 done:
     return empty_clst;
@@ -197,43 +295,171 @@ done:
 
 /** Project 4: Filesys - Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
-void fat_remove_chain(cluster_t clst, cluster_t pclst) {
+void fat_remove_chain(struct volume *v, cluster_t clst, cluster_t pclst) {
     /* TODO: Your code goes here. */
+    struct fat_fs *fat_fs = v->fat_fs;
     cluster_t target = clst;
 
-    if (pclst == 0)
-        fat_put(pclst, EOChain);
-    else {
-        while (fat_get(target) != EOChain) {  // 순회하면서 FAT에서 할당 해제
-            cluster_t next = fat_get(target);
-            fat_put(target, 0);
-            target = next;
-        }
+    if (pclst != 0)
+        fat_put(v, pclst, EOChain);
+
+    while (target != 0 && target != EOChain) {  // 순회하면서 FAT에서 할당 해제
+        cluster_t next = fat_get(v, target);
+
+        /** Project 4: Clone - 다른 file과 공유 중인 cluster는 참조 수만 줄인다. */
+        if (fat_fs->refcnt[target] > 0)
+            refcnt_put(v, target, fat_fs->refcnt[target] - 1);
+        else
+            fat_put(v, target, 0);
+        target = next;
     }
 }
 
 /** Project 4: Filesys - Update a value in the FAT table. */
-void fat_put(cluster_t clst, cluster_t val) {
+void fat_put(struct volume *v, cluster_t clst, cluster_t val) {
+    struct fat_fs *fat_fs = v->fat_fs;
+
+    /** Project 4: Journaling - 긴 chain을 고치는 중이면 FAT entry 사이에서 handle을 나눈다.
+     * 호출하는 쪽은 link를 끊은 뒤에 cluster를 해제하므로 나뉘어도 cluster가 새기만 한다. */
+    journal_extend(v);
+
     /* TODO: Your code goes here. */
     fat_fs->fat[clst] = val;
+
+    /** Project 4: Tmpfs - 해제된 cluster의 memory 반환 */
+    if (val == 0)
+        volume_discard(v, cluster_to_sector(v, clst));
+
+    /** Project 4: Journaling - 바뀐 FAT sector를 transaction에 기록 */
+    const size_t per_sector = DISK_SECTOR_SIZE / sizeof(cluster_t);
+    size_t idx = clst / per_sector;
+    size_t left = fat_fs->fat_length - idx * per_sector;
+    cluster_t *src = fat_fs->fat + idx * per_sector;
+
+    if (left >= per_sector)
+        journal_write(v, fat_fs->bs.fat_start + idx, src);
+    else {
+        cluster_t bounce[DISK_SECTOR_SIZE / sizeof(cluster_t)] = {0};
+        memcpy(bounce, src, left * sizeof(cluster_t));
+        journal_write(v, fat_fs->bs.fat_start + idx, bounce);
+    }
+}
+
+/** Project 4: Clone - CLST의 참조 수를 VAL로 바꾸고 해당 sector를 transaction에 기록 */
+static void refcnt_put(struct volume *v, cluster_t clst, uint8_t val) {
+    struct fat_fs *fat_fs = v->fat_fs;
+    size_t idx = clst / DISK_SECTOR_SIZE;
+
+    journal_extend(v);
+
+    if (fat_fs->refcnt[clst] == 0 && val > 0)
+        fat_fs->shared_cnt++;
+    else if (fat_fs->refcnt[clst] > 0 && val == 0)
+        fat_fs->shared_cnt--;
+    fat_fs->refcnt[clst] = val;
+
+    journal_write(v, fat_fs->bs.refcnt_start + idx, fat_fs->refcnt + idx * DISK_SECTOR_SIZE);
+}
+
+/** Project 4: Clone - START부터의 chain 전체를 한 file이 더 참조하게 한다.
+ * 참조 수가 넘치는 cluster가 있으면 아무것도 바꾸지 않고 false. */
+bool fat_share_chain(struct volume *v, cluster_t start) {
+    struct fat_fs *fat_fs = v->fat_fs;
+    cluster_t clst;
+
+    if (fat_fs->bs.refcnt_sectors == 0)
+        return false;
+
+    for (clst = start; clst != 0 && clst != EOChain; clst = fat_get(v, clst))
+        if (fat_fs->refcnt[clst] == UINT8_MAX)
+            return false;
+
+    for (clst = start; clst != 0 && clst != EOChain; clst = fat_get(v, clst))
+        refcnt_put(v, clst, fat_fs->refcnt[clst] + 1);
+
+    return true;
+}
+
+/** Project 4: Clone - chain의 LAST번째 cluster까지 공유 중인 cluster를 복사해서 이 file만의 것으로 만든다.
+ * 공유는 항상 chain의 뒷부분에서 일어나므로, 앞 cluster의 link를 바꾸려면 그 앞도 모두 복사해야 한다.
+ * 시작 cluster가 바뀌면 *START를 갱신한다. 빈 cluster가 모자라면 false. */
+bool fat_unshare_chain(struct volume *v, cluster_t *start, size_t last) {
+    struct fat_fs *fat_fs = v->fat_fs;
+    cluster_t prev = 0, clst = *start;
+    uint8_t *buf = NULL;
+    bool success = true;
+    size_t i;
+
+    if (fat_fs->shared_cnt == 0)  // 공유 cluster가 하나도 없으면 바로 끝
+        return true;
+
+    for (i = 0; i <= last && clst != 0 && clst != EOChain; i++) {
+        cluster_t next = fat_get(v, clst);
+
+        if (fat_fs->refcnt[clst] > 0) {
+            cluster_t copy = get_empty_cluster(v);
+
+            if (buf == NULL)
+                buf = malloc(DISK_SECTOR_SIZE);
+            if (copy >= fat_fs->fat_length || buf == NULL) {
+                success = false;
+                break;
+            }
+
+            /* Data를 먼저 복사하고 link를 바꾼다. 중간에 멈춰도 chain은 유효하다. */
+            volume_read(v, cluster_to_sector(v, clst), buf);
+            journal_revoke(v, cluster_to_sector(v, copy));
+            if (!volume_write(v, cluster_to_sector(v, copy), buf)) {  // tmpfs memory 부족
+                success = false;
+                break;
+            }
+
+            fat_put(v, copy, next);
+            if (prev == 0)
+                *start = copy;
+            else
+                fat_put(v, prev, copy);
+            refcnt_put(v, clst, fat_fs->refcnt[clst] - 1);
+            clst = copy;
+        }
+
+        prev = clst;
+        clst = next;
+    }
+    free(buf);
+
+    return success;
+}
+
+/** Project 4: Clone - START부터의 chain에 공유 중인 cluster가 있으면 true */
+bool fat_chain_shared(struct volume *v, cluster_t start) {
+    cluster_t clst;
+
+    if (v->fat_fs->shared_cnt == 0)
+        return false;
+
+    for (clst = start; clst != 0 && clst != EOChain; clst = fat_get(v, clst))
+        if (v->fat_fs->refcnt[clst] > 0)
+            return true;
+    return false;
 }
 
 /** Project 4: Filesys - Fetch a value in the FAT table. */
-cluster_t fat_get(cluster_t clst) {
+cluster_t fat_get(struct volume *v, cluster_t clst) {
     /* TODO: Your code goes here. */
-    return fat_fs->fat[clst];
+    return v->fat_fs->fat[clst];
 }
 
 /** Project 4: Filesys - Covert a cluster # to a sector number.
  * 클러스터 넘버 clst를 상응하는 섹터 넘버로 변환하고, 그 섹터 넘버를 리턴합니다. */
-disk_sector_t cluster_to_sector(cluster_t clst) {
+disk_sector_t cluster_to_sector(struct volume *v, cluster_t clst) {
     /* TODO: Your code goes here. */
-    return fat_fs->data_start + clst;
+    return v->fat_fs->data_start + clst;
 }
 
 /** Project 4: Filesys - 섹터 넘버를 clst로 변환해서 리턴 */
-cluster_t sector_to_cluster(disk_sector_t sctr) {
-    cluster_t clst = sctr - fat_fs->data_start;
+cluster_t sector_to_cluster(struct volume *v, disk_sector_t sctr) {
+    cluster_t clst = sctr - v->fat_fs->data_start;
 
     return clst < 2 ? 0 : clst;
 }
\ No newline at end of file
@@ -5,17 +5,21 @@
 #include <string.h>
 
 #include "devices/disk.h"
+#include "filesys/defrag.h"
 #include "filesys/directory.h"
 #include "filesys/fat.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "filesys/volume.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
 /** #Project 4: File System */
 struct disk *filesys_disk;
 
-static void do_format(void);
+static void do_format(struct volume *);
 
 /* Thêm hàm báo cáo bộ nhớ */
 void report_memory_usage(void) {
@@ -38,23 +42,31 @@ void filesys_init(bool format) {
     if (filesys_disk == NULL)
         PANIC("hd0:1 (hdb) not present, file system initialization failed");
 
+    /** Project 4: Mount - hd0:1은 "/"에 붙는 root volume */
+    volume_init();
+    root_volume = volume_create(filesys_disk);
+    if (root_volume == NULL)
+        PANIC("root volume creation failed");
+
     inode_init();
 
 #ifdef EFILESYS
-    fat_init();
+    fat_init(root_volume);
 
     if (format)
-        do_format();
+        do_format(root_volume);
 
-    fat_open();
+    fat_open(root_volume);
 
     thread_current()->cwd = dir_open_root(); /** #Project 4: File System - hiện tại thread의 cwd를 root로 설정 */
+
+    defrag_init(); /** Project 4: Defrag */
 #else
     /* Original FS */
     free_map_init();
 
     if (format)
-        do_format();
+        do_format(root_volume);
 
     free_map_open();
 #endif
@@ -63,7 +75,11 @@ void filesys_init(bool format) {
 /* Shuts down the file system module, writing any unwritten data to disk. */
 void filesys_done(void) {
 #ifdef EFILESYS
-    fat_close();
+    defrag_done(); /** Project 4: Defrag - 옮기는 중인 file이 없게 defragd부터 멈춘다. */
+    volume_done(); /** Project 4: Mount - mount된 volume들 먼저 반영 */
+    journal_done(root_volume); /** Project 4: Journaling - 남은 transaction commit 및 checkpoint */
+    fat_close(root_volume);
+    defrag_print_stats();
 #else
     free_map_close();
 #endif
@@ -77,34 +93,38 @@ bool filesys_create(const char *name, off_t initial_size) {
 #ifndef EFILESYS
     disk_sector_t inode_sector = 0;
     struct dir *dir = dir_open_root();
-    bool success = (dir != NULL && free_map_allocate(1, &inode_sector) && inode_create(inode_sector, initial_size, FILE_TYPE) && dir_add(dir, name, inode_sector));
+    bool success = (dir != NULL && free_map_allocate(1, &inode_sector) && inode_create(root_volume, inode_sector, initial_size, FILE_TYPE) && dir_add(dir, name, inode_sector));
     if (!success && inode_sector != 0)
         free_map_release(inode_sector, 1);
     dir_close(dir);
     return success;
 #else
-    cluster_t inode_cluster = fat_create_chain(0);
-    disk_sector_t inode_sector = cluster_to_sector(inode_cluster);
-    bool success;
+    bool success = false;
 
     char target[128];
     target[0] = '\0';
 
-    struct dir *dir_path = parse_path(name, target);
+    struct dir *dir = parse_path(name, target);
 
-    if (strcmp(target, "") == 0)
+    if (strcmp(target, "") == 0 || dir == NULL || inode_is_removed(dir_get_inode(dir))) {
+        dir_close(dir);
         return false;
+    }
 
-    if (dir_path == NULL || inode_is_removed(dir_get_inode(dir_path)))
-        return false;
+    /** Project 4: Mount - 상위 directory가 있는 volume에 만든다. */
+    struct volume *vol = inode_get_volume(dir_get_inode(dir));
 
-    struct dir *dir = dir_reopen(dir_path);
+    journal_begin(vol); /** Project 4: Journaling - FAT, inode, dir_entry 갱신을 하나의 transaction으로 */
 
-    success = (dir != NULL && inode_create(inode_sector, initial_size, FILE_TYPE) && dir_add(dir, target, inode_sector));
+    cluster_t inode_cluster = fat_create_chain(vol, 0);
+    disk_sector_t inode_sector = cluster_to_sector(vol, inode_cluster);
 
-    if (!success && inode_sector != 0)
-        fat_remove_chain(inode_cluster, 1);
+    success = (inode_cluster != 0 && inode_create(vol, inode_sector, initial_size, FILE_TYPE) && dir_add(dir, target, inode_sector));
 
+    if (!success && inode_cluster != 0)
+        fat_remove_chain(vol, inode_cluster, 0);
+
+    journal_end(vol);
     dir_close(dir);
 
     return success;
@@ -181,7 +201,11 @@ bool filesys_remove(const char *name) {
     struct dir *dir_path = parse_path(name, target);
 
     if (dir_path == NULL)
-        goto done;
+        return false;
+
+    struct volume *vol = inode_get_volume(dir_get_inode(dir_path));
+
+    journal_begin(vol); /** Project 4: Journaling */
 
     struct inode *inode = NULL;
 
@@ -194,61 +218,65 @@ bool filesys_remove(const char *name) {
         struct dir *target_dir = parse_path(inode_get_linkpath(inode), target);
 
         if (!dir_lookup(target_dir, target, &inode))
-            return NULL;
+            goto done;
 
         if (inode_is_removed(inode))
-            return NULL;
+            goto done;
     }
 
     if (inode_get_type(inode) == 1) {  // nếu là thư mục
         struct dir *dir = dir_open(inode);
 
         if (!dir_is_empty(dir) || inode_is_removed(inode))
-            return false;
+            goto done;
 
         dir_finddir(dir, dir_path, target);
         dir_close(dir);
 
-        return dir_remove(dir_path, target);
+        success = dir_remove(dir_path, target);
+        goto done;
     }
 
     struct dir *file = dir_reopen(dir_path);  // nếu là tệp
 
     success = file != NULL && dir_remove(file, target);
 
-    if (dir_lookup(dir_path, target, &inode))
-        return false;
+    if (dir_lookup(dir_path, target, &inode)) {
+        success = false;
+        goto done;
+    }
 
     file_close(file);
 done:
+    journal_end(vol);
     dir_close(dir_path);
     return success;
 #endif
 }
 
 /* Formats the file system. */
-static void do_format(void) {
+static void do_format(struct volume *v) {
     printf("Formatting file system...");
 
 #ifdef EFILESYS
     /* Create FAT and save it to the disk. */
-    fat_create();
+    fat_create(v);
 
     /* Root Directory 생성 */
-    disk_sector_t root = cluster_to_sector(ROOT_DIR_CLUSTER);
-    if (!dir_create(root, 16))
+    disk_sector_t root = cluster_to_sector(v, ROOT_DIR_CLUSTER);
+    if (!dir_create(v, root, 16))
         PANIC("root directory creation failed");
 
     /* Root Directory에 ., .. 추가 */
-    struct dir *root_dir = dir_open_root();
+    struct dir *root_dir = dir_open_volume(v);
     dir_add(root_dir, ".", root);
     dir_add(root_dir, "..", root);
     dir_close(root_dir);
 
-    fat_close();
+    fat_close(v);
 #else
     free_map_create();
-    if (!dir_create(ROOT_DIR_SECTOR, 16))
+    if (!dir_create(v, ROOT_DIR_SECTOR, 16))
         PANIC("root directory creation failed");
     free_map_close();
 #endif
@@ -270,8 +298,11 @@ struct dir *parse_path(char *path_name, char *target) {
     token = strtok_r(path, "/", &ptr);
     next_token = strtok_r(NULL, "/", &ptr);
 
-    if (token == NULL)  // path_name = "/" 만 입력되었을 때
+    if (token == NULL) {  // path_name = "/" 만 입력되었을 때
+        free(path);
+        dir_close(dir);
         return dir_open_root();
+    }
 
     while (next_token != NULL) {
         struct inode *inode = NULL;
@@ -283,8 +314,10 @@ struct dir *parse_path(char *path_name, char *target) {
             target[0] = '\0';
 
             struct dir *target_dir = parse_path(inode_get_linkpath(inode), target);
+            bool found = target_dir != NULL && dir_lookup(target_dir, target, &inode);
 
-            if (!dir_lookup(target_dir, target, &inode))
+            dir_close(target_dir);
+            if (!found)
                 goto err;
         }
 
@@ -307,43 +340,67 @@ err:
     return NULL;
 }
 
-bool filesys_chdir(const char *dir_name) {
-    struct inode *inode = NULL;
+/** Project 4: Mount - PATH가 가리키는 inode를 *INODE에 연다. "/"는 root directory. */
+static bool path_lookup(const char *path, struct inode **inode) {
     char target[128];
     target[0] = '\0';
-    struct dir *dir = parse_path(dir_name, target);
+    struct dir *dir = parse_path((char *)path, target);
+    bool success;
 
-    if (!dir_lookup(dir, target, &inode))
+    if (dir == NULL)
         return false;
 
-    if (inode_get_type(inode) == 0 || inode_is_removed(inode))
+    if (target[0] == '\0') {
+        *inode = inode_reopen(dir_get_inode(dir));
+        success = true;
+    } else
+        success = dir_lookup(dir, target, inode);
+
+    dir_close(dir);
+    return success;
+}
+
+bool filesys_chdir(const char *dir_name) {
+    struct inode *inode = NULL;
+
+    if (!path_lookup(dir_name, &inode))
         return false;
 
-    dir = dir_open(inode);
+    if (inode_get_type(inode) == 0 || inode_is_removed(inode)) {
+        inode_close(inode);
+        return false;
+    }
 
-    thread_current()->cwd = dir;
+    /** Project 4: Mount - 이전 cwd를 닫아야 umount된 volume이 정리될 수 있다. */
+    dir_close(thread_current()->cwd);
+    thread_current()->cwd = dir_open(inode);
 
     return true;
 }
 
 bool filesys_mkdir(const char *dir_name) {
-    cluster_t inode_cluster = fat_create_chain(0);
-    disk_sector_t inode_sector = cluster_to_sector(inode_cluster);
     char target[128];
+    target[0] = '\0';
+    bool success = false;
 
     if (strlen(dir_name) == 0)
         return false;
 
-    struct dir *dir_path = parse_path(dir_name, target);
-    if (dir_path == NULL)
+    struct dir *dir = parse_path(dir_name, target);
+    if (dir == NULL)
         return false;
 
-    struct dir *dir = dir_reopen(dir_path);
+    struct volume *vol = inode_get_volume(dir_get_inode(dir));
+
+    journal_begin(vol); /** Project 4: Journaling */
+
+    cluster_t inode_cluster = fat_create_chain(vol, 0);
+    disk_sector_t inode_sector = cluster_to_sector(vol, inode_cluster);
 
-    bool success = (dir != NULL && inode_create(inode_sector, 0, DIR_TYPE) && dir_add(dir, target, inode_sector));
+    success = (inode_cluster != 0 && inode_create(vol, inode_sector, 0, DIR_TYPE) && dir_add(dir, target, inode_sector));
 
     if (!success && inode_cluster != 0)
-        fat_remove_chain(inode_cluster, 0);
+        fat_remove_chain(vol, inode_cluster, 0);
 
     if (success) {  // thêm . và .. vào thư mục
         struct inode *inode = NULL;
@@ -358,40 +415,198 @@ bool filesys_mkdir(const char *dir_name) {
         dir_close(new_dir);
     }
 
+    journal_end(vol);
     dir_close(dir);
 
     return success;
 }
 
 bool filesys_symlink(const char *target, const char *linkpath) {
-    cluster_t inode_cluster = fat_create_chain(0);
-    disk_sector_t inode_sector = cluster_to_sector(inode_cluster);
-
     struct inode *target_inode = NULL;
     struct inode *inode = NULL;
-    bool success;
+    bool success = false;
 
     char link_name[128];
     link_name[0] = '\0';
 
     struct dir *link_dir = parse_path(linkpath, link_name);
 
-    if (strcmp(link_name, "") == 0)
+    if (strcmp(link_name, "") == 0 || link_dir == NULL || inode_is_removed(dir_get_inode(link_dir))) {
+        dir_close(link_dir);
         return false;
+    }
 
-    if (link_dir == NULL || inode_is_removed(dir_get_inode(link_dir)))
-        return false;
+    struct volume *vol = inode_get_volume(dir_get_inode(link_dir));
+
+    journal_begin(vol); /** Project 4: Journaling */
 
-    success = (link_dir != NULL && inode_create(inode_sector, 0, LINK_TYPE) && dir_add(link_dir, link_name, inode_sector));
+    cluster_t inode_cluster = fat_create_chain(vol, 0);
+    disk_sector_t inode_sector = cluster_to_sector(vol, inode_cluster);
 
-    if (!success && inode_sector != 0) {
-        fat_remove_chain(inode_cluster, 1);
-        return success;
+    success = (inode_cluster != 0 && inode_create(vol, inode_sector, 0, LINK_TYPE) && dir_add(link_dir, link_name, inode_sector));
+
+    if (!success && inode_cluster != 0) {
+        fat_remove_chain(vol, inode_cluster, 0);
+        goto done;
     }
 
     dir_lookup(link_dir, link_name, &inode);
 
     inode_set_linkpath(inode, target);
-
+done:
+    journal_end(vol);
+    dir_close(link_dir);
     return success;
 }
+
+#ifdef EFILESYS
+/** Project 4: Clone - SRC의 data를 복사하지 않고 cluster를 공유하는 새 file DST를 만든다.
+ * 공유된 cluster는 처음 쓸 때 복사된다. 성공하면 0, 실패하면 -1. */
+int filesys_clone(const char *src, const char *dst) {
+    struct inode *src_inode = NULL;
+    char target[128];
+    target[0] = '\0';
+    bool success = false;
+
+    if (!path_lookup(src, &src_inode))
+        return -1;
+
+    struct dir *dir = parse_path((char *)dst, target);
+    struct volume *vol = inode_get_volume(src_inode);
+
+    /* 같은 volume의 일반 file만 clone 할 수 있다. */
+    if (dir == NULL || target[0] == '\0' || inode_is_removed(dir_get_inode(dir)) ||
+        inode_get_volume(dir_get_inode(dir)) != vol || inode_get_type(src_inode) != FILE_TYPE ||
+        inode_is_removed(src_inode))
+        goto done;
+
+    journal_begin(vol);
+
+    cluster_t inode_cluster = fat_create_chain(vol, 0);
+    disk_sector_t inode_sector = cluster_to_sector(vol, inode_cluster);
+
+    if (inode_cluster != 0 && inode_clone(src_inode, inode_sector)) {
+        success = dir_add(dir, target, inode_sector);
+        if (!success)  // 늘린 참조 수를 되돌린다.
+            fat_remove_chain(vol, sector_to_cluster(vol, inode_get_start(src_inode)), 0);
+    }
+
+    if (!success && inode_cluster != 0)
+        fat_remove_chain(vol, inode_cluster, 0);
+
+    journal_end(vol);
+done:
+    dir_close(dir);
+    inode_close(src_inode);
+    return success ? 0 : -1;
+}
+#endif
+
+/** Project 4: Mount - V가 덮어써도 되는 빈 disk면 true. 모든 sector가 0이거나,
+ * host와 file을 주고받는 scratch disk(hd1:0)여서 boot 때 put/get이 이미 다 쓴 경우다. */
+static bool volume_is_blank(struct volume *v, bool scratch) {
+    uint8_t *buf = malloc(DISK_SECTOR_SIZE);
+    bool blank = buf != NULL;
+
+    for (disk_sector_t sector = 0; blank && sector < volume_size(v); sector++) {
+        volume_read(v, sector, buf);
+        if (sector == 0 && scratch && (!memcmp(buf, "PUT", 4) || !memcmp(buf, "GET", 4)))
+            break;  // fsutil.c의 scratch 형식
+        for (size_t i = 0; blank && i < DISK_SECTOR_SIZE; i++)
+            blank = buf[i] == 0;
+    }
+    free(buf);
+    return blank;
+}
+
+/** Project 4: Mount - CHAN_NO:DEV_NO disk를 directory PATH에 mount 한다.
+ * 빈 disk는 처음 붙일 때 format 하고, boot disk(hd0:0)와 다른 내용이 있는 disk는 붙이지 않는다.
+ * CHAN_NO가 TMPFS_CHAN_NO면 memory 위에 새 tmpfs를 만든다. 성공하면 0, 실패하면 -1. */
+int filesys_mount(const char *path, int chan_no, int dev_no) {
+    bool tmpfs = chan_no == TMPFS_CHAN_NO;
+    struct disk *disk = NULL;
+    struct inode *inode = NULL;
+    struct volume *v;
+
+    if (!tmpfs) {  // disk_get은 잘못된 번호를 ASSERT로 막으므로 먼저 거른다.
+        if (chan_no < 0 || (dev_no != 0 && dev_no != 1))
+            return -1;
+        disk = disk_get(chan_no, dev_no);
+    }
+
+    /* hd0:0은 kernel이 올라 있는 boot disk다. */
+    if (!tmpfs && (disk == NULL || (chan_no == 0 && dev_no == 0) || volume_disk_in_use(disk)))
+        return -1;
+#ifdef VM
+    if (chan_no == 1 && dev_no == 1)  // swap disk
+        return -1;
+#endif
+
+    if (!path_lookup(path, &inode))
+        return -1;
+
+    /* Directory만, 그리고 이미 다른 volume의 root인 곳에는 붙일 수 없다. */
+    if (inode_get_type(inode) != DIR_TYPE || inode_is_removed(inode) || volume_is_root_inode(inode)) {
+        inode_close(inode);
+        return -1;
+    }
+
+    v = tmpfs ? NULL : volume_find_unmounted(disk);  // 아직 정리되지 않은 volume이면 그대로 다시 붙인다.
+    if (tmpfs) {
+        v = volume_create_ram(TMPFS_SECTORS);
+        if (v == NULL) {
+            inode_close(inode);
+            return -1;
+        }
+
+        fat_init(v);
+        do_format(v);
+        fat_open(v);
+        if (v->write_error) {  // format할 memory도 없었다.
+            volume_destroy(v);
+            inode_close(inode);
+            return -1;
+        }
+    } else if (v == NULL) {
+        v = volume_create(disk);
+        if (v == NULL) {
+            inode_close(inode);
+            return -1;
+        }
+
+        /* FAT이 아니면 빈 disk일 때만 format 한다. 다른 내용이 있는 disk를 덮어쓰지 않는다. */
+        if (!fat_init(v)) {
+            if (!volume_is_blank(v, chan_no == 1 && dev_no == 0)) {
+                volume_destroy(v);
+                inode_close(inode);
+                return -1;
+            }
+            do_format(v);
+        }
+        fat_open(v);
+    }
+
+    volume_attach(v, inode);
+    return 0;
+}
+
+/** Project 4: Mount - PATH에 mount된 volume을 떼어낸다. 열린 inode가 남아 있으면
+ * 마지막 inode가 닫힐 때 disk에 반영된다 (lazy umount). */
+int filesys_umount(const char *path) {
+    struct inode *inode = NULL;
+    struct volume *v;
+    bool mounted;
+
+    if (!path_lookup(path, &inode))
+        return -1;
+
+    v = inode_get_volume(inode);
+    mounted = v != root_volume && volume_is_root_inode(inode);
+    inode_close(inode);
+
+    if (!mounted)
+        return -1;
+
+    volume_detach(v);
+    return 0;
+}
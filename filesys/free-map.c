@@ -6,6 +6,7 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/volume.h"
 
 static struct file *free_map_file; /* Free map file. */
 static struct bitmap *free_map;    /* Free map, one bit per disk sector. */
@@ -43,7 +44,7 @@ void free_map_release(disk_sector_t sector, size_t cnt) {
 
 /* Opens the free map file and reads it from disk. */
 void free_map_open(void) {
-    free_map_file = file_open(inode_open(FREE_MAP_SECTOR));
+    free_map_file = file_open(inode_open(root_volume, FREE_MAP_SECTOR));
     if (free_map_file == NULL)
         PANIC("can't open free map");
     if (!bitmap_read(free_map, free_map_file))
@@ -59,11 +60,11 @@ void free_map_close(void) {
  * it. */
 void free_map_create(void) {
     /* Create inode. */
-    if (!inode_create(FREE_MAP_SECTOR, bitmap_file_size(free_map), FILE_TYPE))
+    if (!inode_create(root_volume, FREE_MAP_SECTOR, bitmap_file_size(free_map), FILE_TYPE))
         PANIC("free map creation failed");
 
     /* Write bitmap to file. */
-    free_map_file = file_open(inode_open(FREE_MAP_SECTOR));
+    free_map_file = file_open(inode_open(root_volume, FREE_MAP_SECTOR));
     if (free_map_file == NULL)
         PANIC("can't open free map");
     if (!bitmap_write(free_map, free_map_file))
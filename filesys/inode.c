@@ -8,6 +8,8 @@
 #include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
+#include "filesys/volume.h"
 #include "threads/malloc.h"
 
 /* Identifies an inode. */
@@ -41,6 +43,7 @@ static struct inode *inode_backup;
 /* In-memory inode. */
 struct inode {
     struct list_elem elem;  /* Element in inode list. */
+    struct volume *vol;     /* Volume this inode lives on. */
     disk_sector_t sector;   /* Sector number of disk location. */
     int open_cnt;           /* Number of openers. */
     bool removed;           /* True if deleted, false otherwise. */
@@ -62,14 +65,10 @@ static disk_sector_t byte_to_sector(const struct inode *inode, off_t pos) {
 }
 #endif
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
-
-/* Initializes the inode module. */
+/* Initializes the inode module.
+ * Open inodes are tracked per volume (struct volume's open_inodes), so
+ * that opening a single inode twice returns the same `struct inode'. */
 void inode_init(void) {
-    list_init(&open_inodes);
-
     /** Project 4: Soft Link */
     inode_backup = NULL;
 }
@@ -79,7 +78,7 @@ void inode_init(void) {
  * the new inode to sector SECTOR on the file system disk.
  * Returns true if successful.
  * Returns false if memory or disk allocation fails. */
-bool inode_create(disk_sector_t sector, off_t length, int32_t type) {
+bool inode_create(struct volume *v, disk_sector_t sector, off_t length, int32_t type) {
     struct inode_disk *disk_inode = NULL;
     bool success = false;
 
@@ -96,13 +95,13 @@ bool inode_create(disk_sector_t sector, off_t length, int32_t type) {
         disk_inode->magic = INODE_MAGIC;
 
         if (free_map_allocate(sectors, &disk_inode->start)) {
-            disk_write(filesys_disk, sector, disk_inode);
+            volume_write(v, sector, disk_inode);
             if (sectors > 0) {
                 static char zeros[DISK_SECTOR_SIZE];
                 size_t i;
 
                 for (i = 0; i < sectors; i++)
-                    disk_write(filesys_disk, disk_inode->start + i, zeros);
+                    volume_write(v, disk_inode->start + i, zeros);
             }
             success = true;
         }
@@ -115,12 +114,12 @@ bool inode_create(disk_sector_t sector, off_t length, int32_t type) {
 /* Reads an inode from SECTOR
  * and returns a `struct inode' that contains it.
  * Returns a null pointer if memory allocation fails. */
-struct inode *inode_open(disk_sector_t sector) {
+struct inode *inode_open(struct volume *v, disk_sector_t sector) {
     struct list_elem *e;
     struct inode *inode;
 
     /* Check whether this inode is already open. */
-    for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
+    for (e = list_begin(&v->open_inodes); e != list_end(&v->open_inodes); e = list_next(e)) {
         inode = list_entry(e, struct inode, elem);
         if (inode->sector == sector) {
             inode_reopen(inode);
@@ -134,12 +133,13 @@ struct inode *inode_open(disk_sector_t sector) {
         return NULL;
 
     /* Initialize. */
-    list_push_front(&open_inodes, &inode->elem);
+    list_push_front(&v->open_inodes, &inode->elem);
+    inode->vol = v;
     inode->sector = sector;
     inode->open_cnt = 1;
     inode->deny_write_cnt = 0;
     inode->removed = false;
-    disk_read(filesys_disk, inode->sector, &inode->data);
+    journal_read(v, inode->sector, &inode->data);
 
     return inode;
 }
@@ -214,7 +214,7 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
 
         if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
             /* Read full sector directly into caller's buffer. */
-            disk_read(filesys_disk, sector_idx, buffer + bytes_read);
+            volume_read(inode->vol, sector_idx, buffer + bytes_read);
         } else {
             /* Read sector into bounce buffer, then partially copy
              * into caller's buffer. */
@@ -223,7 +223,7 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
                 if (bounce == NULL)
                     break;
             }
-            disk_read(filesys_disk, sector_idx, bounce);
+            volume_read(inode->vol, sector_idx, bounce);
             memcpy(buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
 
@@ -267,7 +267,7 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t
 
         if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
             /* Write full sector directly to disk. */
-            disk_write(filesys_disk, sector_idx, buffer + bytes_written);
+            volume_write(inode->vol, sector_idx, buffer + bytes_written);
         } else {
             /* We need a bounce buffer. */
             if (bounce == NULL) {
@@ -280,11 +280,11 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t
                we're writing, then we need to read in the sector
                first.  Otherwise we start with a sector of all zeros. */
             if (sector_ofs > 0 || chunk_size < sector_left)
-                disk_read(filesys_disk, sector_idx, bounce);
+                volume_read(inode->vol, sector_idx, bounce);
             else
                 memset(bounce, 0, DISK_SECTOR_SIZE);
             memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
-            disk_write(filesys_disk, sector_idx, bounce);
+            volume_write(inode->vol, sector_idx, bounce);
         }
 
         /* Advance. */
@@ -320,26 +320,44 @@ off_t inode_length(const struct inode *inode) {
 }
 
 #ifdef EFILESYS
+/** Project 4: Journaling - directory의 data는 metadata이므로 journal을 거친다. */
+static void inode_sector_read(const struct inode *inode, disk_sector_t sector, void *buffer) {
+    if (inode->data.type == DIR_TYPE)
+        journal_read(inode->vol, sector, buffer);
+    else
+        volume_read(inode->vol, sector, buffer);
+}
+
+/* Tmpfs memory가 모자라 쓰지 못했으면 false. */
+static bool inode_sector_write(const struct inode *inode, disk_sector_t sector, const void *buffer) {
+    if (inode->data.type == DIR_TYPE)
+        return journal_write(inode->vol, sector, buffer);
+
+    journal_revoke(inode->vol, sector);  // 예전 metadata가 나중에 덮어쓰지 않도록
+    return volume_write(inode->vol, sector, buffer);
+}
+
 static disk_sector_t byte_to_sector(const struct inode *inode, off_t pos) {
     ASSERT(inode != NULL);
 
-    cluster_t target = sector_to_cluster(inode->data.start);
+    struct volume *v = inode->vol;
+    cluster_t target = sector_to_cluster(v, inode->data.start);
 
     while (pos >= DISK_SECTOR_SIZE) {  // file length보다 pos가 크면 새로운 cluster를 할당
-        if (fat_get(target) == EOChain)
-            fat_create_chain(target);
+        if (fat_get(v, target) == EOChain && fat_create_chain(v, target) == 0)
+            return -1;  // 빈 cluster가 없다.
 
-        target = fat_get(target);
+        target = fat_get(v, target);
         pos -= DISK_SECTOR_SIZE;
     }
 
-    disk_sector_t sector = cluster_to_sector(target);
+    disk_sector_t sector = cluster_to_sector(v, target);
     return sector;
 }
 
 /** #Project 4: File System - Initializes an inode with LENGTH bytes of data and writes
  * the new inode to sector SECTOR on the file system disk. */
-bool inode_create(disk_sector_t sector, off_t length, int32_t type) {
+bool inode_create(struct volume *v, disk_sector_t sector, off_t length, int32_t type) {
     struct inode_disk *disk_inode = NULL;
     cluster_t start_clst;
     bool success = false;
@@ -357,10 +375,14 @@ bool inode_create(disk_sector_t sector, off_t length, int32_t type) {
         disk_inode->type = type;
 
         /* data cluster allocation */
-        if (start_clst = fat_create_chain(0)) {
-            disk_inode->start = cluster_to_sector(start_clst);
+        if (start_clst = fat_create_chain(v, 0)) {
+            disk_inode->start = cluster_to_sector(v, start_clst);
             /* write disk_inode on disk */
-            disk_write(filesys_disk, sector, disk_inode);
+            if (!journal_write(v, sector, disk_inode)) {  // tmpfs memory 부족
+                fat_remove_chain(v, start_clst, 0);
+                free(disk_inode);
+                return false;
+            }
 
             if (sectors > 0) {
                 static char zeros[DISK_SECTOR_SIZE];
@@ -370,10 +392,20 @@ bool inode_create(disk_sector_t sector, off_t length, int32_t type) {
 
                 /* make cluster chain based length and initialize zero*/
                 while (sectors > 0) {
-                    w_sector = cluster_to_sector(target);
-                    disk_write(filesys_disk, w_sector, zeros);
-
-                    target = fat_create_chain(target);
+                    w_sector = cluster_to_sector(v, target);
+                    if (type == DIR_TYPE)
+                        journal_write(v, w_sector, zeros);
+                    else {
+                        journal_revoke(v, w_sector);
+                        volume_write(v, w_sector, zeros);
+                    }
+
+                    target = fat_create_chain(v, target);
+                    if (target == 0) {  // 빈 cluster가 없다.
+                        fat_remove_chain(v, start_clst, 0);
+                        free(disk_inode);
+                        return false;
+                    }
                     sectors--;
                 }
             }
@@ -397,18 +429,26 @@ void inode_close(struct inode *inode) {
     if (--inode->open_cnt == 0) {
         struct inode *data_inode = check_is_link(inode);  // link에 원본 data를 저장
 
+        struct volume *v = inode->vol;
+
         /* Remove from inode list and release lock. */
         list_remove(&inode->elem);
 
         /* Deallocate blocks if removed. */
-        if (inode->removed)
-            fat_remove_chain(inode->sector, 0);
-
-        disk_write(filesys_disk, inode->sector, &data_inode->data);  // inode close 시 disk에 저장
+        if (inode->removed) {
+            /** Project 4: Clone - 공유 중인 data cluster는 fat_remove_chain이 참조 수만 줄인다. */
+            fat_remove_chain(v, sector_to_cluster(v, inode->data.start), 0);
+            fat_remove_chain(v, sector_to_cluster(v, inode->sector), 0);
+        } else
+            journal_write(v, inode->sector, &data_inode->data);  // inode close 시 disk에 저장
 
         data_inode = return_is_link(inode);
 
         free(inode);
+
+        /** Project 4: Mount - umount된 volume의 마지막 inode였다면 volume 정리 */
+        if (v->unmounted && list_empty(&v->open_inodes))
+            volume_release(v);
     }
 }
 
@@ -437,7 +477,7 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
 
         if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
             /* Read full sector directly into caller's buffer. */
-            disk_read(filesys_disk, sector_idx, buffer + bytes_read);
+            inode_sector_read(inode, sector_idx, buffer + bytes_read);
         } else {
             /* Read sector into bounce buffer, then partially copy
              * into caller's buffer. */
@@ -446,7 +486,7 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
                 if (bounce == NULL)
                     break;
             }
-            disk_read(filesys_disk, sector_idx, bounce);
+            inode_sector_read(inode, sector_idx, bounce);
             memcpy(buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
 
@@ -462,6 +502,19 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
     return bytes_read;
 }
 
+/** Project 4: Clone - INODE의 LAST번째 cluster까지를 다른 file과 공유하지 않게 만든다. */
+static bool inode_unshare(struct inode *inode, size_t last) {
+    struct volume *v = inode->vol;
+    cluster_t start = sector_to_cluster(v, inode->data.start);
+    bool success = fat_unshare_chain(v, &start, last);
+
+    if (cluster_to_sector(v, start) != inode->data.start) {
+        inode->data.start = cluster_to_sector(v, start);
+        journal_write(v, inode->sector, &inode->data);
+    }
+    return success;
+}
+
 /** #Project 4: File System - Writes SIZE bytes from BUFFER into INODE, starting at OFFSET. */
 off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t offset) {
     const uint8_t *buffer = buffer_;
@@ -474,11 +527,21 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t
 
     inode = check_is_link(inode);
 
+    /** Project 4: Clone - 쓸 범위의 cluster가 공유 중이면 먼저 복사 (copy on write) */
+    if (size > 0 && !inode_unshare(inode, (offset + size - 1) / DISK_SECTOR_SIZE)) {
+        inode = return_is_link(inode);
+        return 0;
+    }
+
     while (size > 0) {
         /* Sector to write, starting byte offset within sector. */
         disk_sector_t sector_idx = byte_to_sector(inode, offset);
         int sector_ofs = offset % DISK_SECTOR_SIZE;
 
+        /** Project 4: Tmpfs - cluster나 tmpfs memory가 모자라면 여기까지 쓴 만큼만 리턴 */
+        if (sector_idx == (disk_sector_t)-1)
+            break;
+
         /* Bytes left in inode, bytes left in sector, lesser of the two. */
         int sector_left = DISK_SECTOR_SIZE - sector_ofs;
         int min_left = sector_left;  // limit 없으므로 삭제
@@ -490,7 +553,8 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t
 
         if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
             /* Write full sector directly to disk. */
-            disk_write(filesys_disk, sector_idx, buffer + bytes_written);
+            if (!inode_sector_write(inode, sector_idx, buffer + bytes_written))
+                break;
         } else {
             /* We need a bounce buffer. */
             if (bounce == NULL) {
@@ -503,11 +567,12 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t
                we're writing, then we need to read in the sector
                first.  Otherwise we start with a sector of all zeros. */
             if (sector_ofs > 0 || chunk_size < sector_left)
-                disk_read(filesys_disk, sector_idx, bounce);
+                inode_sector_read(inode, sector_idx, bounce);
             else
                 memset(bounce, 0, DISK_SECTOR_SIZE);
             memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
-            disk_write(filesys_disk, sector_idx, bounce);
+            if (!inode_sector_write(inode, sector_idx, bounce))
+                break;
         }
 
         /* Advance. */
@@ -524,6 +589,17 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size, off_t
 
     return bytes_written;
 }
+
+/** Project 4: Clone - SRC와 data cluster를 공유하는 새 inode를 같은 volume의 SECTOR에 만든다. */
+bool inode_clone(struct inode *src, disk_sector_t sector) {
+    struct volume *v = src->vol;
+
+    if (!fat_share_chain(v, sector_to_cluster(v, src->data.start)))
+        return false;
+
+    journal_write(v, sector, &src->data);
+    return true;
+}
 #endif
 
 /** #Project 4: File System - Returns the type, in bool, of INODE's data. */
@@ -536,6 +612,27 @@ bool inode_is_removed(const struct inode *inode) {
     return inode->removed;
 }
 
+/** Project 4: Defrag - Returns the first data sector of INODE. */
+disk_sector_t inode_get_start(const struct inode *inode) {
+    return inode->data.start;
+}
+
+/** Project 4: Defrag - data의 시작 sector를 바꾸고 on-disk inode도 바로 갱신 */
+void inode_set_start(struct inode *inode, disk_sector_t start) {
+    inode->data.start = start;
+    journal_write(inode->vol, inode->sector, &inode->data);
+}
+
+/** Project 4: Mount - Returns the volume INODE lives on. */
+struct volume *inode_get_volume(const struct inode *inode) {
+    return inode->vol;
+}
+
+/** Project 4: Defrag - Returns the number of openers of INODE. */
+int inode_open_cnt(const struct inode *inode) {
+    return inode->open_cnt;
+}
+
 /** #Project 4: File System - Returns the sector, in bytes, of INODE */
 disk_sector_t inode_sector(struct inode *inode) {
     return inode->sector;
@@ -0,0 +1,536 @@
+/* journal.c: Write-ahead metadata journal for the FAT file system. */
+
+#include "filesys/journal.h"
+
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devices/timer.h"
+#include "filesys/volume.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define JOURNAL_MAGIC 0x4a524e4c  /* "JRNL" */
+#define JOURNAL_DESC_MAGIC 0x4a444553
+#define JOURNAL_COMMIT_MAGIC 0x4a434d54
+
+/* Descriptor 하나에 기록할 수 있는 최대 block 수 */
+#define JOURNAL_DESC_MAX 125
+
+/** Project 4: Journaling - handle 하나가 시작할 때 running transaction에 예약하는 block 수 */
+#define JOURNAL_HANDLE_CREDITS 32
+/* journal_extend에서 남은 credit이 이보다 적으면 handle을 나눈다. */
+#define JOURNAL_EXTEND_CREDITS 8
+
+/** Project 4: Journaling - journald가 running transaction을 commit하는 주기 */
+#define JOURNAL_COMMIT_INTERVAL TIMER_FREQ
+
+/* Journal 영역의 첫 sector. */
+struct journal_super {
+    uint32_t magic;
+    uint32_t seq; /* 다음 replay를 시작할 transaction 번호 */
+    uint32_t unused[126];
+};
+
+/* Transaction 시작: 뒤따르는 data block들의 home sector. */
+struct journal_desc {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t cnt;
+    disk_sector_t sectors[JOURNAL_DESC_MAX];
+};
+
+/* Transaction 끝: 이 block이 온전히 기록되어야 replay 대상이 된다. */
+struct journal_commit {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t checksum;
+    uint32_t unused[125];
+};
+
+/* Memory에 들고 있는 metadata sector 하나. */
+struct journal_block {
+    struct hash_elem elem;
+    disk_sector_t sector;
+    uint8_t data[DISK_SECTOR_SIZE];
+};
+
+struct journal {
+    struct volume *vol;
+    disk_sector_t start; /* Super block sector */
+    disk_sector_t end;   /* Journal 영역의 끝 (exclusive) */
+    disk_sector_t head;  /* 다음 transaction을 append할 위치 */
+    uint32_t seq;        /* 다음 commit에 붙일 transaction 번호 */
+    bool active;
+
+    struct hash running;    /* 아직 log에 쓰이지 않은 block */
+    struct hash checkpoint; /* log에는 있지만 home에 쓰이지 않은 block */
+
+    struct lock lock;
+    struct condition idle; /* handles == 0 */
+    int handles;           /* 진행 중인 filesys 연산 수 */
+    size_t reserved;       /* 열린 handle들이 아직 쓰지 않은 credit의 합 */
+};
+
+static void journal_do_commit(struct journal *);
+static void journal_do_checkpoint(struct journal *);
+static void journal_recover(struct journal *);
+static void journald(void *aux);
+
+static uint64_t journal_hash(const struct hash_elem *e, void *aux UNUSED) {
+    const struct journal_block *b = hash_entry(e, struct journal_block, elem);
+    return hash_int(b->sector);
+}
+
+static bool journal_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED) {
+    return hash_entry(a, struct journal_block, elem)->sector < hash_entry(b, struct journal_block, elem)->sector;
+}
+
+static void journal_free(struct hash_elem *e, void *aux UNUSED) {
+    free(hash_entry(e, struct journal_block, elem));
+}
+
+static struct journal_block *journal_find(struct hash *h, disk_sector_t sector) {
+    struct journal_block key;
+    struct hash_elem *e;
+
+    key.sector = sector;
+    e = hash_find(h, &key.elem);
+    return e != NULL ? hash_entry(e, struct journal_block, elem) : NULL;
+}
+
+static uint32_t journal_checksum(struct journal_block **blocks, size_t cnt) {
+    uint32_t checksum = 0;
+
+    for (size_t i = 0; i < cnt; i++)
+        checksum = checksum * 31 + hash_bytes(blocks[i]->data, DISK_SECTOR_SIZE);
+    return checksum;
+}
+
+static void journal_write_super(struct journal *j) {
+    struct journal_super *super = calloc(1, sizeof *super);
+    if (super == NULL)
+        PANIC("journal super block write failed");
+
+    super->magic = JOURNAL_MAGIC;
+    super->seq = j->seq;
+    volume_write(j->vol, j->start, super);
+    free(super);
+}
+
+/** Project 4: Journaling - journal 영역을 비어 있는 상태로 초기화 (format 시) */
+void journal_format(struct volume *v, disk_sector_t start, size_t sector_cnt) {
+    struct journal j = {.vol = v, .start = start, .seq = 1};
+
+    ASSERT(sizeof(struct journal_super) == DISK_SECTOR_SIZE);
+
+    if (sector_cnt == 0)
+        return;
+    journal_write_super(&j);
+}
+
+/** Project 4: Journaling - journal을 열고 commit된 transaction을 replay한 뒤 journald 시작.
+ * SECTOR_CNT가 0이면 journal 없이 write-through로 동작한다. */
+void journal_init(struct volume *v, disk_sector_t start, size_t sector_cnt) {
+    struct journal *j;
+
+    ASSERT(sizeof(struct journal_desc) == DISK_SECTOR_SIZE);
+    ASSERT(sizeof(struct journal_commit) == DISK_SECTOR_SIZE);
+
+    v->journal = NULL;
+    if (sector_cnt < JOURNAL_DESC_MAX + 3)
+        return;
+
+    j = calloc(1, sizeof *j);
+    if (j == NULL)
+        PANIC("journal init failed");
+
+    j->vol = v;
+    j->start = start;
+    j->end = start + sector_cnt;
+    j->head = start + 1;
+    j->handles = 0;
+    j->reserved = 0;
+    lock_init(&j->lock);
+    cond_init(&j->idle);
+    if (!hash_init(&j->running, journal_hash, journal_less, NULL) ||
+        !hash_init(&j->checkpoint, journal_hash, journal_less, NULL))
+        PANIC("journal init failed");
+
+    journal_recover(j);
+    j->active = true;
+    v->journal = j;
+
+    thread_create("journald", PRI_DEFAULT, journald, j);
+}
+
+/** Project 4: Journaling - 종료 시 남은 transaction을 commit하고 모두 checkpoint */
+void journal_done(struct volume *v) {
+    struct journal *j = v->journal;
+
+    if (j == NULL)
+        return;
+
+    lock_acquire(&j->lock);
+    while (j->handles > 0)
+        cond_wait(&j->idle, &j->lock);
+    journal_do_commit(j);
+    journal_do_checkpoint(j);
+    j->active = false;
+    v->journal = NULL;  // 이후로는 write-through. j는 journald가 해제
+    lock_release(&j->lock);
+}
+
+/** Project 4: Journaling - filesys 연산 하나를 transaction handle로 감싼다.
+ * 시작할 때 JOURNAL_HANDLE_CREDITS만큼 running에 자리를 예약하므로 handle 도중에는 commit하지 않는다.
+ * 자리가 없으면 열린 handle이 모두 끝나기를 기다렸다가 먼저 commit한다. */
+void journal_begin(struct volume *v) {
+    struct journal *j = v->journal;
+    struct thread *t = thread_current();
+
+    if (j == NULL)
+        return;
+
+    ASSERT(t->journal == NULL);
+
+    lock_acquire(&j->lock);
+    while (hash_size(&j->running) + j->reserved + JOURNAL_HANDLE_CREDITS > JOURNAL_DESC_MAX) {
+        if (j->handles == 0)
+            journal_do_commit(j);
+        else
+            cond_wait(&j->idle, &j->lock);
+    }
+    j->handles++;
+    j->reserved += JOURNAL_HANDLE_CREDITS;
+    lock_release(&j->lock);
+
+    t->journal = j;
+    t->journal_credits = JOURNAL_HANDLE_CREDITS;
+}
+
+/* 마지막 handle이 끝났을 때 running이 충분히 쌓였으면 바로 commit,
+ * 아니면 journald가 주기적으로 묶어서 commit한다 (group commit). */
+void journal_end(struct volume *v) {
+    struct journal *j = v->journal;
+    struct thread *t = thread_current();
+
+    if (j == NULL)
+        return;
+
+    ASSERT(t->journal == j);
+
+    lock_acquire(&j->lock);
+    ASSERT(j->handles > 0);
+    j->reserved -= t->journal_credits;  // 쓰지 않은 credit 반납
+    t->journal = NULL;
+    t->journal_credits = 0;
+    if (--j->handles == 0) {
+        if (hash_size(&j->running) >= JOURNAL_DESC_MAX / 2)
+            journal_do_commit(j);
+        cond_broadcast(&j->idle, &j->lock);
+    }
+    lock_release(&j->lock);
+}
+
+/** Project 4: Journaling - FAT chain을 길게 고치는 loop가 부른다.
+ * 현재 handle의 credit이 거의 떨어졌으면 handle을 끝내고 새로 연다. 앞부분은 그 사이에 commit될 수 있으므로
+ * 여기서 끊겨도 disk가 일관되어야 한다 (최악의 경우 어디에도 연결되지 않은 cluster가 남는다). */
+void journal_extend(struct volume *v) {
+    struct journal *j = v->journal;
+    struct thread *t = thread_current();
+
+    if (j == NULL || t->journal != j || t->journal_credits >= JOURNAL_EXTEND_CREDITS)
+        return;
+
+    journal_end(v);
+    journal_begin(v);
+}
+
+/* 진행 중인 handle이 모두 끝나기를 기다린 후 commit. */
+void journal_commit(struct volume *v) {
+    struct journal *j = v->journal;
+
+    if (j == NULL)
+        return;
+
+    lock_acquire(&j->lock);
+    while (j->handles > 0)
+        cond_wait(&j->idle, &j->lock);
+    journal_do_commit(j);
+    lock_release(&j->lock);
+}
+
+void journal_checkpoint(struct volume *v) {
+    struct journal *j = v->journal;
+
+    if (j == NULL)
+        return;
+
+    lock_acquire(&j->lock);
+    journal_do_checkpoint(j);
+    lock_release(&j->lock);
+}
+
+/** Project 4: Journaling - metadata sector 읽기. running > checkpoint > disk 순서로 최신 값을 찾는다.
+ * Journal이 없는 volume이면 disk에서 바로 읽는다. */
+void journal_read(struct volume *v, disk_sector_t sector, void *buffer) {
+    struct journal *j = v->journal;
+    struct journal_block *b;
+
+    if (j == NULL) {
+        volume_read(v, sector, buffer);
+        return;
+    }
+
+    lock_acquire(&j->lock);
+    if ((b = journal_find(&j->running, sector)) != NULL || (b = journal_find(&j->checkpoint, sector)) != NULL)
+        memcpy(buffer, b->data, DISK_SECTOR_SIZE);
+    else
+        volume_read(v, sector, buffer);
+    lock_release(&j->lock);
+}
+
+/** Project 4: Journaling - metadata sector 쓰기. home이 아닌 running transaction에 기록한다.
+ * Journal이 없는 volume이면 바로 쓰고, tmpfs memory가 모자라 쓰지 못했으면 false. */
+bool journal_write(struct volume *v, disk_sector_t sector, const void *buffer) {
+    struct journal *j = v->journal;
+    struct journal_block *b;
+
+    if (j == NULL)
+        return volume_write(v, sector, buffer);
+
+    lock_acquire(&j->lock);
+    b = journal_find(&j->running, sector);
+    if (b == NULL) {
+        struct thread *t = thread_current();
+
+        if (t->journal == j) {
+            /* Handle 안에서는 commit하지 않고 예약해 둔 credit을 쓴다. */
+            if (t->journal_credits > 0) {
+                t->journal_credits--;
+                j->reserved--;
+            } else if (hash_size(&j->running) + j->reserved >= JOURNAL_DESC_MAX)
+                PANIC("journal handle ran out of credits");
+        } else if (hash_size(&j->running) + j->reserved >= JOURNAL_DESC_MAX) {
+            /* Handle 밖의 write는 열린 handle이 모두 끝난 뒤에 commit하고 자리를 만든다. */
+            while (j->handles > 0)
+                cond_wait(&j->idle, &j->lock);
+            journal_do_commit(j);
+        }
+
+        b = malloc(sizeof *b);
+        if (b == NULL)
+            PANIC("journal block allocation failed");
+        b->sector = sector;
+        hash_insert(&j->running, &b->elem);
+    }
+    memcpy(b->data, buffer, DISK_SECTOR_SIZE);
+    lock_release(&j->lock);
+    return true;
+}
+
+/** Project 4: Journaling - metadata였던 SECTOR가 일반 data로 재사용될 때 호출.
+ * Data를 home에 직접 쓰기 전에 불러야 오래된 metadata가 덮어쓰지 않는다. */
+void journal_revoke(struct volume *v, disk_sector_t sector) {
+    struct journal *j = v->journal;
+    struct journal_block *b;
+
+    if (j == NULL)
+        return;
+
+    lock_acquire(&j->lock);
+    if ((b = journal_find(&j->running, sector)) != NULL) {
+        hash_delete(&j->running, &b->elem);
+        free(b);
+    }
+    /* Log에 남아 있으면 recovery 때 replay되므로 log를 비운다. */
+    if (journal_find(&j->checkpoint, sector) != NULL)
+        journal_do_checkpoint(j);
+    lock_release(&j->lock);
+}
+
+/* HASH의 block들을 배열로 모은다. 개수는 *CNT에 저장. */
+static struct journal_block **journal_collect(struct hash *h, size_t *cnt) {
+    struct journal_block **blocks;
+    struct hash_iterator i;
+    size_t n = 0;
+
+    *cnt = hash_size(h);
+    if (*cnt == 0)
+        return NULL;
+
+    blocks = malloc(*cnt * sizeof *blocks);
+    if (blocks == NULL)
+        PANIC("journal out of memory");
+
+    hash_first(&i, h);
+    while (hash_next(&i))
+        blocks[n++] = hash_entry(hash_cur(&i), struct journal_block, elem);
+    return blocks;
+}
+
+static int journal_block_cmp(const void *a, const void *b) {
+    disk_sector_t x = (*(struct journal_block *const *)a)->sector;
+    disk_sector_t y = (*(struct journal_block *const *)b)->sector;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Running transaction을 log 끝에 순차적으로 append: descriptor, data, commit block.
+ * 기록이 끝난 block들은 checkpoint로 옮긴다. J->lock을 잡은 상태로 호출. */
+static void journal_do_commit(struct journal *j) {
+    struct journal_block **blocks;
+    struct journal_desc *desc;
+    struct journal_commit *commit;
+    size_t cnt;
+
+    ASSERT(lock_held_by_current_thread(&j->lock));
+
+    blocks = journal_collect(&j->running, &cnt);
+    if (blocks == NULL)
+        return;
+    ASSERT(cnt <= JOURNAL_DESC_MAX);
+
+    /* Log 공간이 부족할 때만 checkpoint (lazy) */
+    if (j->head + cnt + 2 > j->end)
+        journal_do_checkpoint(j);
+
+    desc = calloc(1, sizeof *desc);
+    commit = calloc(1, sizeof *commit);
+    if (desc == NULL || commit == NULL)
+        PANIC("journal commit failed");
+
+    desc->magic = JOURNAL_DESC_MAGIC;
+    desc->seq = j->seq;
+    desc->cnt = cnt;
+    for (size_t i = 0; i < cnt; i++)
+        desc->sectors[i] = blocks[i]->sector;
+
+    commit->magic = JOURNAL_COMMIT_MAGIC;
+    commit->seq = j->seq;
+    commit->checksum = journal_checksum(blocks, cnt);
+
+    volume_write(j->vol, j->head++, desc);
+    for (size_t i = 0; i < cnt; i++)
+        volume_write(j->vol, j->head++, blocks[i]->data);
+    volume_write(j->vol, j->head++, commit);
+    j->seq++;
+
+    free(desc);
+    free(commit);
+
+    /* running -> checkpoint. 같은 sector의 이전 버전은 버린다. */
+    hash_clear(&j->running, NULL);
+    for (size_t i = 0; i < cnt; i++) {
+        struct hash_elem *old = hash_replace(&j->checkpoint, &blocks[i]->elem);
+        if (old != NULL)
+            journal_free(old, NULL);
+    }
+    free(blocks);
+}
+
+/* Commit된 block들을 sector 순서로 home에 쓰고 log를 비운다. J->lock을 잡은 상태로 호출. */
+static void journal_do_checkpoint(struct journal *j) {
+    struct journal_block **blocks;
+    size_t cnt;
+
+    blocks = journal_collect(&j->checkpoint, &cnt);
+    if (blocks != NULL) {
+        qsort(blocks, cnt, sizeof *blocks, journal_block_cmp);
+        for (size_t i = 0; i < cnt; i++)
+            volume_write(j->vol, blocks[i]->sector, blocks[i]->data);
+        free(blocks);
+        hash_clear(&j->checkpoint, journal_free);
+    }
+
+    /* 이후 seq부터 replay하도록 super block 갱신 */
+    journal_write_super(j);
+    j->head = j->start + 1;
+}
+
+/* Super block의 seq부터 commit block까지 온전한 transaction만 home에 replay. */
+static void journal_recover(struct journal *j) {
+    struct journal_super *super = malloc(DISK_SECTOR_SIZE);
+    struct journal_desc *desc = malloc(DISK_SECTOR_SIZE);
+    struct journal_commit *commit = malloc(DISK_SECTOR_SIZE);
+    struct journal_block **blocks = calloc(JOURNAL_DESC_MAX, sizeof *blocks);
+    disk_sector_t pos = j->start + 1;
+    int replayed = 0;
+
+    if (super == NULL || desc == NULL || commit == NULL || blocks == NULL)
+        PANIC("journal recovery failed");
+
+    volume_read(j->vol, j->start, super);
+    j->seq = super->magic == JOURNAL_MAGIC ? super->seq : 1;
+
+    while (super->magic == JOURNAL_MAGIC && pos + 2 <= j->end) {
+        size_t cnt, i;
+
+        volume_read(j->vol, pos, desc);
+        if (desc->magic != JOURNAL_DESC_MAGIC || desc->seq != j->seq || desc->cnt > JOURNAL_DESC_MAX ||
+            pos + desc->cnt + 2 > j->end)
+            break;
+        cnt = desc->cnt;
+
+        for (i = 0; i < cnt; i++) {
+            blocks[i] = malloc(sizeof **blocks);
+            if (blocks[i] == NULL)
+                PANIC("journal recovery failed");
+            blocks[i]->sector = desc->sectors[i];
+            volume_read(j->vol, pos + 1 + i, blocks[i]->data);
+        }
+        volume_read(j->vol, pos + 1 + cnt, commit);
+
+        bool valid = commit->magic == JOURNAL_COMMIT_MAGIC && commit->seq == j->seq &&
+                     commit->checksum == journal_checksum(blocks, cnt);
+        for (i = 0; i < cnt; i++) {
+            if (valid)
+                volume_write(j->vol, blocks[i]->sector, blocks[i]->data);
+            free(blocks[i]);
+        }
+        if (!valid)
+            break;
+
+        pos += cnt + 2;
+        j->seq++;
+        replayed++;
+    }
+
+    if (replayed > 0)
+        printf("journal: replayed %d transaction(s)\n", replayed);
+
+    journal_write_super(j);
+
+    free(super);
+    free(desc);
+    free(commit);
+    free(blocks);
+}
+
+/* Group commit daemon. */
+static void journald(void *aux) {
+    struct journal *j = aux;
+
+    while (true) {
+        timer_sleep(JOURNAL_COMMIT_INTERVAL);
+
+        lock_acquire(&j->lock);
+        if (!j->active) {
+            lock_release(&j->lock);
+            break;
+        }
+        while (j->handles > 0)
+            cond_wait(&j->idle, &j->lock);
+        journal_do_commit(j);
+        lock_release(&j->lock);
+    }
+
+    /* journal_done 이후: volume은 이미 j를 놓았다. */
+    hash_destroy(&j->running, journal_free);
+    hash_destroy(&j->checkpoint, journal_free);
+    free(j);
+}
@@ -6,3 +6,6 @@ filesys_SRC += filesys/directory.c	# Directories.
 filesys_SRC += filesys/inode.c		# File headers.
 filesys_SRC += filesys/fsutil.c		# Utilities.
 filesys_SRC += filesys/page_cache.c		# Page cache.
+filesys_SRC += filesys/journal.c	# Metadata journal.
+filesys_SRC += filesys/defrag.c	# Background defragmenter.
+filesys_SRC += filesys/volume.c	# Mounted volumes.
@@ -0,0 +1,281 @@
+/* volume.c: Mounted file system volumes. */
+
+#include "filesys/volume.h"
+
+#include <debug.h>
+#include <string.h>
+
+#include "filesys/fat.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+
+/** Project 4: Mount */
+struct volume *root_volume;
+
+static struct list mounts;   /* mount된 volume들 (root 제외) */
+static struct list detached; /* umount 되었지만 열린 inode가 남은 volume들 */
+static struct lock volume_lock;
+
+/** Project 4: Tmpfs - mount된 tmpfs 수와 tmpfs들이 잡고 있는 sector 수. volume_lock이 보호 */
+static size_t tmpfs_cnt;
+static size_t tmpfs_sectors;
+
+void volume_init(void) {
+    list_init(&mounts);
+    list_init(&detached);
+    lock_init(&volume_lock);
+}
+
+/** Project 4: Mount - DISK 위의 volume을 만든다. FAT은 fat_init에서 읽는다. */
+struct volume *volume_create(struct disk *disk) {
+    struct volume *v = calloc(1, sizeof *v);
+    if (v == NULL)
+        return NULL;
+
+    v->disk = disk;
+    list_init(&v->open_inodes);
+    return v;
+}
+
+/** Project 4: Tmpfs - disk 없이 SIZE sector짜리 volume을 만든다.
+ * Sector는 처음 쓸 때 malloc 되고, cluster가 해제되면 volume_discard로 돌려준다. */
+struct volume *volume_create_ram(disk_sector_t size) {
+    struct volume *v;
+
+    lock_acquire(&volume_lock);
+    if (tmpfs_cnt >= TMPFS_MAX_VOLUMES) {
+        lock_release(&volume_lock);
+        return NULL;
+    }
+    tmpfs_cnt++;
+    lock_release(&volume_lock);
+
+    v = volume_create(NULL);
+    if (v != NULL && (v->ram = calloc(size, sizeof *v->ram)) != NULL) {
+        v->ram_size = size;
+        return v;
+    }
+
+    free(v);
+    lock_acquire(&volume_lock);
+    tmpfs_cnt--;
+    lock_release(&volume_lock);
+    return NULL;
+}
+
+/* Tmpfs sector 하나의 memory. 모든 tmpfs를 합쳐 TMPFS_MAX_SECTORS개까지만 준다. */
+static uint8_t *tmpfs_sector_alloc(void) {
+    uint8_t *sector = NULL;
+
+    lock_acquire(&volume_lock);
+    if (tmpfs_sectors < TMPFS_MAX_SECTORS && (sector = malloc(DISK_SECTOR_SIZE)) != NULL)
+        tmpfs_sectors++;
+    lock_release(&volume_lock);
+    return sector;
+}
+
+static void tmpfs_sector_free(uint8_t *sector) {
+    if (sector == NULL)
+        return;
+
+    free(sector);
+    lock_acquire(&volume_lock);
+    tmpfs_sectors--;
+    lock_release(&volume_lock);
+}
+
+static bool sector_is_zero(const void *buffer) {
+    const uint64_t *p = buffer;
+
+    for (size_t i = 0; i < DISK_SECTOR_SIZE / sizeof *p; i++)
+        if (p[i] != 0)
+            return false;
+    return true;
+}
+
+/* V의 sector 수. */
+disk_sector_t volume_size(struct volume *v) {
+    return v->ram != NULL ? v->ram_size : disk_size(v->disk);
+}
+
+/* Volume의 sector I/O. 서로 다른 volume은 서로 다른 channel lock을 쓰므로 병렬로 진행된다. */
+void volume_read(struct volume *v, disk_sector_t sector, void *buffer) {
+    if (v->ram == NULL) {
+        disk_read(v->disk, sector, buffer);
+        return;
+    }
+
+    ASSERT(sector < v->ram_size);
+    if (v->ram[sector] != NULL)
+        memcpy(buffer, v->ram[sector], DISK_SECTOR_SIZE);
+    else
+        memset(buffer, 0, DISK_SECTOR_SIZE);  // 한 번도 안 쓴 sector는 0
+}
+
+/* Tmpfs에서 sector에 줄 memory가 없으면 아무것도 쓰지 않고 false. Disk volume은 항상 true. */
+bool volume_write(struct volume *v, disk_sector_t sector, const void *buffer) {
+    if (v->ram == NULL) {
+        disk_write(v->disk, sector, buffer);
+        return true;
+    }
+
+    ASSERT(sector < v->ram_size);
+    if (v->ram[sector] == NULL) {
+        if (sector_is_zero(buffer))  // 한 번도 안 쓴 sector는 이미 0으로 읽힌다.
+            return true;
+
+        v->ram[sector] = tmpfs_sector_alloc();
+        if (v->ram[sector] == NULL) {
+            v->write_error = true;
+            return false;
+        }
+    }
+    memcpy(v->ram[sector], buffer, DISK_SECTOR_SIZE);
+    return true;
+}
+
+/** Project 4: Tmpfs - 더 이상 쓰지 않는 SECTOR의 memory를 돌려준다. disk volume에서는 아무것도 안 함 */
+void volume_discard(struct volume *v, disk_sector_t sector) {
+    if (v->ram == NULL || sector >= v->ram_size)
+        return;
+
+    tmpfs_sector_free(v->ram[sector]);
+    v->ram[sector] = NULL;
+}
+
+/** Project 4: Mount - V를 MOUNT_POINT directory에 붙인다. MOUNT_POINT의 참조는 V가 가진다. */
+void volume_attach(struct volume *v, struct inode *mount_point) {
+    lock_acquire(&volume_lock);
+    if (v->unmounted)
+        list_remove(&v->elem);
+    v->unmounted = false;
+    v->mount_point = mount_point;
+    list_push_back(&mounts, &v->elem);
+    lock_release(&volume_lock);
+}
+
+/** Project 4: Mount - Lazy umount. 더 이상 path로는 찾을 수 없고,
+ * 마지막 inode가 닫힐 때 volume_release로 정리된다. */
+void volume_detach(struct volume *v) {
+    struct inode *mount_point;
+    bool idle;
+
+    lock_acquire(&volume_lock);
+    list_remove(&v->elem);
+    list_push_back(&detached, &v->elem);
+    mount_point = v->mount_point;
+    v->mount_point = NULL;
+    v->unmounted = true;
+    idle = list_empty(&v->open_inodes);
+    lock_release(&volume_lock);
+
+    inode_close(mount_point);
+    if (idle)
+        volume_release(v);
+}
+
+/* INODE에 mount된 volume. 없으면 NULL. */
+struct volume *volume_mounted_on(const struct inode *inode) {
+    struct volume *found = NULL;
+    struct list_elem *e;
+
+    lock_acquire(&volume_lock);
+    for (e = list_begin(&mounts); e != list_end(&mounts); e = list_next(e)) {
+        struct volume *v = list_entry(e, struct volume, elem);
+        if (v->mount_point == inode) {
+            found = v;
+            break;
+        }
+    }
+    lock_release(&volume_lock);
+
+    return found;
+}
+
+/* 아직 정리되지 않은 umount된 DISK의 volume. 다시 mount할 때 재사용한다. */
+struct volume *volume_find_unmounted(struct disk *disk) {
+    struct volume *found = NULL;
+    struct list_elem *e;
+
+    lock_acquire(&volume_lock);
+    for (e = list_begin(&detached); e != list_end(&detached); e = list_next(e)) {
+        struct volume *v = list_entry(e, struct volume, elem);
+        if (v->disk == disk) {
+            found = v;
+            break;
+        }
+    }
+    lock_release(&volume_lock);
+
+    return found;
+}
+
+/* DISK가 이미 어딘가에 mount되어 있으면 true. tmpfs(NULL)는 몇 개든 mount 가능 */
+bool volume_disk_in_use(struct disk *disk) {
+    struct list_elem *e;
+    bool in_use = root_volume != NULL && root_volume->disk == disk;
+
+    if (disk == NULL)
+        return false;
+
+    lock_acquire(&volume_lock);
+    for (e = list_begin(&mounts); e != list_end(&mounts) && !in_use; e = list_next(e))
+        in_use = list_entry(e, struct volume, elem)->disk == disk;
+    lock_release(&volume_lock);
+
+    return in_use;
+}
+
+/* INODE가 자기 volume의 root directory면 true. */
+bool volume_is_root_inode(const struct inode *inode) {
+    struct volume *v = inode_get_volume(inode);
+
+    return inode_get_inumber(inode) == cluster_to_sector(v, ROOT_DIR_CLUSTER);
+}
+
+/* Volume을 disk에 반영하고 FAT 상태를 해제. */
+static void volume_flush(struct volume *v) {
+    journal_done(v);
+    fat_close(v);
+}
+
+/** Project 4: Mount - umount된 V의 마지막 inode가 닫혔을 때 호출. */
+void volume_release(struct volume *v) {
+    ASSERT(v->unmounted);
+    ASSERT(list_empty(&v->open_inodes));
+
+    lock_acquire(&volume_lock);
+    list_remove(&v->elem);
+    lock_release(&volume_lock);
+
+    volume_flush(v);
+    volume_destroy(v);
+}
+
+/** Project 4: Mount - 붙어 있지 않은 V의 memory를 해제. Disk에는 아무것도 쓰지 않는다. */
+void volume_destroy(struct volume *v) {
+    fat_destroy(v);
+
+    if (v->ram != NULL) {  // tmpfs는 umount와 함께 내용도 사라진다.
+        disk_sector_t sector;
+        for (sector = 0; sector < v->ram_size; sector++)
+            tmpfs_sector_free(v->ram[sector]);
+        free(v->ram);
+
+        lock_acquire(&volume_lock);
+        tmpfs_cnt--;
+        lock_release(&volume_lock);
+    }
+    free(v);
+}
+
+/** Project 4: Mount - 종료 시 root를 제외한 모든 volume을 disk에 반영. */
+void volume_done(void) {
+    struct list_elem *e;
+
+    for (e = list_begin(&mounts); e != list_end(&mounts); e = list_next(e))
+        volume_flush(list_entry(e, struct volume, elem));
+    for (e = list_begin(&detached); e != list_end(&detached); e = list_next(e))
+        volume_flush(list_entry(e, struct volume, elem));
+}
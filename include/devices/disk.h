@@ -2,6 +2,7 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* Size of a disk sector in bytes. */
@@ -15,6 +16,10 @@ typedef uint32_t disk_sector_t;
  * printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* Most sectors a single disk_read_multi() or disk_write_multi()
+ * can transfer. */
+#define DISK_MULTI_MAX 256
+
 void disk_init (void);
 void disk_print_stats (void);
 
@@ -22,6 +27,8 @@ struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
+void disk_read_multi (struct disk *, disk_sector_t, void *, size_t cnt);
+void disk_write_multi (struct disk *, disk_sector_t, const void *, size_t cnt);
 
 void 	register_disk_inspect_intr ();
 #endif /* devices/disk.h */
@@ -0,0 +1,9 @@
+#ifndef FILESYS_DEFRAG_H
+#define FILESYS_DEFRAG_H
+
+/** Project 4: Defrag */
+void defrag_init(void);
+void defrag_done(void);
+void defrag_print_stats(void);
+
+#endif /* filesys/defrag.h */
@@ -18,23 +18,33 @@ typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
 
-void fat_init (void);
-void fat_open (void);
-void fat_close (void);
-void fat_create (void);
-void fat_close (void);
+struct volume;
+
+bool fat_init (struct volume *);
+void fat_open (struct volume *);
+void fat_close (struct volume *);
+void fat_create (struct volume *);
+void fat_destroy (struct volume *);
 
 cluster_t fat_create_chain (
+    struct volume *v,
     cluster_t clst /* Cluster # to stretch, 0: Create a new chain */
 );
 void fat_remove_chain (
+    struct volume *v,
     cluster_t clst, /* Cluster # to be removed */
     cluster_t pclst /* Previous cluster of clst, 0: clst is the start of chain */
 );
-cluster_t fat_get (cluster_t clst);
-void fat_put (cluster_t clst, cluster_t val);
-disk_sector_t cluster_to_sector (cluster_t clst);
+cluster_t fat_get (struct volume *v, cluster_t clst);
+void fat_put (struct volume *v, cluster_t clst, cluster_t val);
+disk_sector_t cluster_to_sector (struct volume *v, cluster_t clst);
 /** Project 4: Indexed and Extensible Files */
-cluster_t sector_to_cluster(disk_sector_t sctr);
+cluster_t sector_to_cluster(struct volume *v, disk_sector_t sctr);
+/** Project 4: Defrag */
+cluster_t fat_find_free_run(struct volume *v, size_t cnt);
+/** Project 4: Clone */
+bool fat_share_chain(struct volume *v, cluster_t start);
+bool fat_unshare_chain(struct volume *v, cluster_t *start, size_t last);
+bool fat_chain_shared(struct volume *v, cluster_t start);
 
 #endif /* filesys/fat.h */
@@ -28,6 +28,16 @@ bool filesys_remove(const char *name);
 struct dir *parse_path(char *, char *);
 bool filesys_chdir(const char *dir_name);
 bool filesys_mkdir(const char *dir_name);
+
+/** Project 4: Mount */
+/** Project 4: Tmpfs - mount()의 CHAN_NO로 주면 disk 대신 memory에 volume을 만든다. */
+#define TMPFS_CHAN_NO -1
+
+int filesys_mount(const char *path, int chan_no, int dev_no);
+int filesys_umount(const char *path);
+
+/** Project 4: Clone */
+int filesys_clone(const char *src, const char *dst);
 #endif
 
 #endif /* filesys/filesys.h */
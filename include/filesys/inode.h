@@ -7,10 +7,11 @@
 #include "filesys/off_t.h"
 
 struct bitmap;
+struct volume;
 
 void inode_init(void);
-bool inode_create(disk_sector_t, off_t, int32_t);
-struct inode *inode_open(disk_sector_t);
+bool inode_create(struct volume *, disk_sector_t, off_t, int32_t);
+struct inode *inode_open(struct volume *, disk_sector_t);
 struct inode *inode_reopen(struct inode *);
 disk_sector_t inode_get_inumber(const struct inode *);
 void inode_close(struct inode *);
@@ -31,4 +32,15 @@ char *inode_get_linkpath(struct inode *);
 struct inode * check_is_link(struct inode *);
 struct inode * return_is_link(struct inode *);
 
+/** Project 4: Defrag */
+disk_sector_t inode_get_start(const struct inode *);
+void inode_set_start(struct inode *, disk_sector_t);
+int inode_open_cnt(const struct inode *);
+
+/** Project 4: Mount */
+struct volume *inode_get_volume(const struct inode *);
+
+/** Project 4: Clone */
+bool inode_clone(struct inode *, disk_sector_t);
+
 #endif /* filesys/inode.h */
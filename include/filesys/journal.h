@@ -0,0 +1,30 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "devices/disk.h"
+
+struct volume;
+
+/** Project 4: Journaling - FAT 뒤에 예약하는 journal 영역의 크기 (super block 포함) */
+#define JOURNAL_SECTORS 128
+
+void journal_format(struct volume *, disk_sector_t start, size_t sector_cnt);
+void journal_init(struct volume *, disk_sector_t start, size_t sector_cnt);
+void journal_done(struct volume *);
+
+/* Transaction. */
+void journal_begin(struct volume *);
+void journal_end(struct volume *);
+void journal_extend(struct volume *);
+void journal_commit(struct volume *);
+void journal_checkpoint(struct volume *);
+
+/* Metadata sector I/O. */
+void journal_read(struct volume *, disk_sector_t, void *);
+bool journal_write(struct volume *, disk_sector_t, const void *);
+void journal_revoke(struct volume *, disk_sector_t);
+
+#endif /* filesys/journal.h */
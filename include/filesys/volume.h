@@ -0,0 +1,56 @@
+#ifndef FILESYS_VOLUME_H
+#define FILESYS_VOLUME_H
+
+#include <list.h>
+#include <stdbool.h>
+
+#include "devices/disk.h"
+#include "threads/synch.h"
+
+struct inode;
+
+/** Project 4: Tmpfs - memory 위에 만드는 volume의 크기 (sector 수) */
+#define TMPFS_SECTORS 4096
+/* 동시에 mount할 수 있는 tmpfs 수와 모든 tmpfs가 함께 쓸 수 있는 sector 수 (4MB) */
+#define TMPFS_MAX_VOLUMES 8
+#define TMPFS_MAX_SECTORS 8192
+
+/** Project 4: Mount - disk 하나 위에 올라간 파일시스템.
+ * FAT, journal, 열린 inode 목록은 모두 volume 단위로 따로 가진다. */
+struct volume {
+    struct disk *disk;        /* Backing disk. tmpfs면 NULL */
+    uint8_t **ram;            /* tmpfs: sector별 memory block, 아직 안 쓴 sector는 NULL */
+    disk_sector_t ram_size;   /* tmpfs: sector 수 */
+    struct fat_fs *fat_fs;    /* FAT 상태 (fat.c) */
+    struct journal *journal;  /* NULL: journal 없이 write-through */
+    struct list open_inodes;  /* 이 volume에서 열린 inode들 */
+
+    struct inode *mount_point; /* 붙어 있는 directory. root volume은 NULL */
+    struct list_elem elem;     /* mounts list element */
+    bool unmounted;            /* umount 되었지만 열린 inode가 남아 있음 */
+    bool write_error;          /* tmpfs: memory가 모자라 sector를 쓰지 못한 적이 있음 */
+};
+
+/* "/"에 붙어 있는 volume. */
+extern struct volume *root_volume;
+
+void volume_init(void);
+void volume_done(void);
+struct volume *volume_create(struct disk *);
+struct volume *volume_create_ram(disk_sector_t size);
+void volume_destroy(struct volume *);
+disk_sector_t volume_size(struct volume *);
+void volume_read(struct volume *, disk_sector_t, void *);
+bool volume_write(struct volume *, disk_sector_t, const void *);
+void volume_discard(struct volume *, disk_sector_t);
+
+/* Mount table. */
+void volume_attach(struct volume *, struct inode *mount_point);
+void volume_detach(struct volume *);
+struct volume *volume_mounted_on(const struct inode *);
+struct volume *volume_find_unmounted(struct disk *);
+bool volume_disk_in_use(struct disk *);
+bool volume_is_root_inode(const struct inode *);
+void volume_release(struct volume *);
+
+#endif /* filesys/volume.h */
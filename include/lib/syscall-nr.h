@@ -36,6 +36,22 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Project 4: Clone */
+	SYS_CLONE,                  /* Clone a file sharing its clusters. */
+
+	/* Project 3: Clustered Writeback */
+	SYS_MSYNC,                  /* Write back a memory mapping. */
+
+	/* Project 3: Madvise */
+	SYS_MADVISE,                /* Give advice about use of memory. */
+	SYS_MINCORE,                /* Report whether pages are resident. */
+
+	/* Project 3: Mlock */
+	SYS_MLOCK,                  /* Lock pages in memory. */
+	SYS_MUNLOCK,                /* Unlock pages. */
+	SYS_MLOCKALL,               /* Lock the whole address space. */
+	SYS_MUNLOCKALL,             /* Unlock the whole address space. */
 };
 
 #endif /* lib/syscall-nr.h */
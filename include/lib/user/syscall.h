@@ -13,6 +13,25 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* mmap_flags() flags. */
+#define MAP_POPULATE 0x8000     /* Read and map the whole range now. */
+
+/* msync() flags. */
+#define MS_ASYNC 1              /* Schedule the writeback and return. */
+#define MS_INVALIDATE 2         /* Accepted for compatibility; mappings are always coherent. */
+#define MS_SYNC 4               /* Write back before returning. */
+
+/* madvise() advice. */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random access; no read-ahead. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential access; read ahead, evict behind. */
+#define MADV_WILLNEED 3         /* Bring the range in now. */
+#define MADV_DONTNEED 4         /* Drop the range; refilled on next access. */
+
+/* mlockall() flags. */
+#define MCL_CURRENT 1           /* Lock every page mapped now. */
+#define MCL_FUTURE 2            /* Lock pages as they are brought in. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -40,7 +59,15 @@ int dup2(int oldfd, int newfd);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void *mmap_flags (void *addr, size_t length, int writable, int fd, off_t offset, int flags);
 void munmap (void *addr);
+int msync (void *addr, size_t length, int flags);
+int madvise (void *addr, size_t length, int advice);
+int mincore (void *addr, size_t length, unsigned char *vec);
+int mlock (void *addr, size_t length);
+int munlock (void *addr, size_t length);
+int mlockall (int flags);
+int munlockall (void);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -49,6 +76,9 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
+int mount (const char *path, int chan_no, int dev_no); /* CHAN_NO -1: tmpfs */
+int umount (const char *path);
+int clone (const char *src, const char *dst);
 
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
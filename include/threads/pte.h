@@ -26,6 +26,9 @@
 #define PDPE(la) ((((uint64_t) (la)) >> PDPESHIFT) & 0x1FF)
 #define PDX(la)  ((((uint64_t) (la)) >> PDXSHIFT) & 0x1FF)
 #define PTX(la)  ((((uint64_t) (la)) >> PTXSHIFT) & 0x1FF)
+/* PDE 하나(PTE_PS)가 매핑하는 large page 크기 (2MB) */
+#define LARGE_PGSIZE (1UL << PDXSHIFT)
+
 #define PTE_ADDR(pte) ((uint64_t) (pte) & ~0xFFF)
 
 /* The important flags are listed below.
@@ -41,5 +44,6 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2MB/1GB large page (PDEs/PDPEs only). */
 
 #endif /* threads/pte.h */
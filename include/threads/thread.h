@@ -151,6 +151,10 @@ typedef struct thread {
     /** Project 4: Filesys - File System */
     struct dir *cwd; // Current Working Directory
 
+    /** Project 4: Journaling - 이 thread가 열어 둔 transaction handle과 남은 credit */
+    struct journal *journal;
+    size_t journal_credits;
+
     /* Owned by thread.c. */
     struct intr_frame tf; /* Information for switching */
     unsigned magic;       /* Detects stack overflow. */
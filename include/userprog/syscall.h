@@ -15,6 +15,25 @@ typedef int pid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* mmap() flags. */
+#define MAP_POPULATE 0x8000
+
+/* msync() flags. */
+#define MS_ASYNC 1
+#define MS_INVALIDATE 2
+#define MS_SYNC 4
+
+/* madvise() advice. */
+#define MADV_NORMAL 0
+#define MADV_RANDOM 1
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED 3
+#define MADV_DONTNEED 4
+
+/* mlockall() flags. */
+#define MCL_CURRENT 1
+#define MCL_FUTURE 2
+
 /** ----- #Project 2: System Call ----- */
 #ifndef VM
 void check_address(void *addr);
@@ -39,14 +58,24 @@ int tell(int fd);
 void close(int fd);
 
 /** Project 3: Memory Mapped Files */
-void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset, int flags);
 void munmap(void *addr);
+int msync(void *addr, size_t length, int flags);
+int madvise(void *addr, size_t length, int advice);
+int mincore(void *addr, size_t length, unsigned char *vec);
+int mlock(void *addr, size_t length);
+int munlock(void *addr, size_t length);
+int mlockall(int flags);
+int munlockall(void);
 
 /** Project 4: File System */
 bool isdir(int fd);
 bool chdir (const char *dir);
 bool mkdir (const char *dir);
 bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
+int mount(const char *path, int chan_no, int dev_no);
+int umount(const char *path);
+int clone(const char *src, const char *dst);
 
 /** #Project 2: System Call */
 extern struct lock filesys_lock;  // 파일 읽기/쓰기 용 lock
@@ -6,10 +6,15 @@
 #include "threads/vaddr.h"
 
 struct page;
+struct frame;
 enum vm_type;
 
 /** Project 3: Swap In/Out - 한 페이지를 섹터 단위로 관리 */
 #define SLOT_SIZE (PGSIZE / DISK_SECTOR_SIZE)
+/** Project 3: Swap Cluster - evict 할 때 한 번에 모아서 swap out하는 최대 page 수 */
+#define SWAP_CLUSTER 8
+/** Project 3: Swap Read-ahead - swap in 할 때 함께 읽는 최대 slot 수 */
+#define SWAP_READAHEAD 8
 
 /** Project 3: Swap In/Out - Sector Indexing용 Page 구조체 선언 */
 struct anon_page {
@@ -18,5 +23,8 @@ struct anon_page {
 
 void vm_anon_init(void);
 bool anon_initializer(struct page *page, enum vm_type type, void *kva);
+void anon_share_slot(struct page *dst, struct page *src);
+bool anon_swap_out_cluster(struct frame **frames, size_t cnt);
+void anon_swap_write(size_t slot, const void *page);
 
 #endif
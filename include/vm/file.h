@@ -11,10 +11,15 @@ struct file_page {
     struct file *file;
     off_t offset;
     size_t page_read_bytes;
+    bool text; /** Project 3: Shared Text - 실행 파일의 read-only segment. 같은 frame을 여러 process가 같이 쓴다. */
 };
 
 void vm_file_init(void);
 bool file_backed_initializer(struct page *page, enum vm_type type, void *kva);
-void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t offset);
+void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t offset, int flags);
 void do_munmap(void *va);
+int do_msync(void *addr, size_t length, int flags);
+
+struct vma;
+void file_writeback(struct vma *vma, void *start, void *end);
 #endif
@@ -20,7 +20,7 @@ enum vm_type {
     /* Auxillary bit flag marker for store information. You can add more
      * markers, until the value is fit in the int. */
     VM_MARKER_0 = (1 << 3),  // STACK MARKER
-    VM_MARKER_1 = (1 << 4),
+    VM_MARKER_1 = (1 << 4),  // SHARED TEXT MARKER
 
     /* DO NOT EXCEED THIS VALUE. */
     VM_MARKER_END = (1 << 31),
@@ -29,6 +29,7 @@ enum vm_type {
 #include "vm/anon.h"
 #include "vm/file.h"
 #include "vm/uninit.h"
+#include "vm/vma.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -51,7 +52,16 @@ struct page {
     /** Project 3: Memory Management - Your implementation */
     struct hash_elem hash_elem;
     bool writable;
-    bool accessible; /** Project 3: Copy On Write (Extra) */
+
+    /** Project 3: Reverse Map */
+    uint64_t *pml4;             /* 이 page를 가진 process의 page table */
+    struct list_elem rmap_elem; /* frame->rmap element */
+
+    /** Project 3: Swap Cluster */
+    struct supplemental_page_table *spt; /* 이 page가 들어 있는 spt */
+
+    /** Project 3: Mlock */
+    bool locked; /* mlock 되어 있어 frame이 evict 되지 않음 */
 
     /* Per-type data are binded into the union.
      * Each function automatically detects the current union */
@@ -68,10 +78,29 @@ struct page {
 /* The representation of "frame" */
 struct frame {
     void *kva;
-    struct page *page;
+    struct page *page; /* 대표 page. 공유 중이면 rmap의 첫 page */
 
     /** Project 3: Memory Management - 리스트 객체 추가  */
     struct list_elem frame_elem;
+
+    /** Project 3: Reverse Map - 이 frame을 매핑한 page들 (process마다 하나).
+     * 둘 이상이 공유하는 동안에는 모든 mapping이 read-only이고 첫 write에서 복사된다. */
+    struct list rmap;
+    int cnt;     /* rmap의 길이 */
+    bool pinned; /* 내용을 채우는 중이라 evict 하면 안 됨 */
+    int locked;  /** Project 3: Mlock - rmap 중 mlock 된 page 수. 0보다 크면 evict 하지 않는다. */
+
+    /** Project 3: KSM */
+    uint64_t ksm_hash;         /* 지난 scan에서 본 내용의 hash */
+    bool ksm_listed;           /* ksm_table에 들어 있음 */
+    bool ksm_merged;           /* 다른 frame이 합쳐진 적 있음 */
+    struct list_elem ksm_elem; /* ksm_table bucket element */
+
+    /** Project 3: Shared Text - 실행 파일의 read-only page를 담고 있으면 파일 위치. text_table에 없으면 text_inode가 NULL */
+    struct inode *text_inode;
+    off_t text_ofs;
+    size_t text_len;            /* 파일에서 읽은 byte 수, 나머지는 0 */
+    struct list_elem text_elem; /* text_table bucket element */
 };
 
 /* 페이지 작업을 위한 함수 테이블입니다.
@@ -96,8 +125,20 @@ struct page_operations {
 
 struct supplemental_page_table {
     struct hash spt_hash; /** Project 3: Memory Management - 해시 테이블 사용 */
+    size_t swap_cursor;   /** Project 3: Swap Cluster - 이 process가 다음에 쓸 swap slot (next-fit) */
+
+    /** Project 3: VMA */
+    struct list vmas;          /* 주소 순으로 정렬된 VMA 목록 */
+    struct vma *vma_cache;     /* 마지막으로 찾은 VMA */
+
+    /** Project 3: Mlock */
+    size_t locked_pages; /* mlock 된 page 수. MLOCK_LIMIT을 넘지 못한다. */
+    bool lock_future;    /* mlockall(MCL_FUTURE). 새로 채우는 page도 mlock 한다. */
 };
 
+/** Project 3: Mlock - process 하나가 mlock 할 수 있는 최대 page 수 */
+#define MLOCK_LIMIT 64
+
 #include "threads/thread.h"
 void supplemental_page_table_init(struct supplemental_page_table *spt);
 bool supplemental_page_table_copy(struct supplemental_page_table *dst, struct supplemental_page_table *src);
@@ -114,7 +155,26 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 void vm_dealloc_page(struct page *page);
 bool vm_claim_page(void *va);
 enum vm_type page_get_type(struct page *page);
+void vm_frame_unmap(struct page *page);
+void vm_frame_unmap_all(struct frame *frame);
+bool vm_frame_dirty(struct frame *frame);
+bool vm_frame_pin_dirty(struct page *page);
+
+/** Project 3: KSM - 기본 scan 속도 (KSM_INTERVAL마다 검사할 frame 수). -ksm=N으로 바꿀 수 있다. */
+#define KSM_SCAN_PAGES 64
+extern size_t ksm_scan_pages;
+extern size_t stack_prefault_pages;
+void ksm_print_stats(void);
 
 bool vm_handle_wp(struct page *page UNUSED);
+bool vm_check_access(void *va, bool write);
+int vm_madvise(void *addr, size_t length, int advice);
+void vm_populate(struct vma *vma, void *start, void *end);
+void vm_populate_stack(void);
+int vm_mlock(void *addr, size_t length);
+int vm_munlock(void *addr, size_t length);
+int vm_mlockall(int flags);
+int vm_munlockall(void);
+int vm_mincore(void *addr, size_t length, unsigned char *vec);
 
 #endif /* VM_VM_H */
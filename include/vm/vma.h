@@ -0,0 +1,40 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+
+struct file;
+struct supplemental_page_table;
+
+/** Project 3: VMA - 같은 방식으로 채워지는 연속된 user 주소 영역 (ELF segment, mmap).
+ * Page마다 struct page와 aux를 미리 만들지 않고, 처음 fault 날 때 VMA를 보고 만든다. */
+struct vma {
+    void *start;          /* 첫 page */
+    void *end;            /* 마지막 page 다음 */
+    enum vm_type type;    /* 만들 page의 type (marker 포함) */
+    bool writable;
+    struct file *file;    /* VMA가 가진 파일. 0으로만 채우면 NULL */
+    off_t offset;         /* start에 해당하는 파일 위치 */
+    size_t read_bytes;    /* start부터 파일에서 읽는 byte 수, 나머지는 0 */
+    bool mmap;            /* mmap으로 만들어져 munmap 할 수 있음 */
+    int advice;           /* madvise로 받은 MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL */
+    struct list_elem elem; /* spt->vmas element, start 순 */
+};
+
+void vma_init(struct supplemental_page_table *spt);
+struct vma *vma_map(struct supplemental_page_table *spt, void *start, void *end, enum vm_type type, bool writable,
+                    struct file *file, off_t offset, size_t read_bytes, bool mmap);
+void vma_unmap(struct supplemental_page_table *spt, struct vma *vma);
+struct vma *vma_find(struct supplemental_page_table *spt, const void *va);
+bool vma_copy(struct supplemental_page_table *dst, struct supplemental_page_table *src);
+void vma_kill(struct supplemental_page_table *spt);
+
+off_t vma_page_offset(const struct vma *vma, const void *va);
+size_t vma_page_read_bytes(const struct vma *vma, const void *va);
+bool vma_zero_fill(const struct vma *vma, const void *va);
+
+#endif
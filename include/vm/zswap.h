@@ -0,0 +1,26 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Project 3: Zswap - swap disk 앞에 두는 압축된 in-memory swap.
+ * Swap slot 번호로 찾고, 자리가 없거나 잘 압축되지 않는 page는 disk로 간다. */
+
+/* 압축 page를 담는 kernel pool arena 크기 (page 수) */
+#define ZSWAP_PAGES 64
+/* Arena 할당 단위 (byte) */
+#define ZSWAP_CHUNK 64
+
+/* zswap_load의 결과 */
+enum zswap_result {
+    ZSWAP_MISS,    /* 압축 tier에 없다. Disk에서 읽는다. */
+    ZSWAP_HIT,     /* PAGE로 풀었다. */
+    ZSWAP_CORRUPT, /* 압축본이 깨져 있다. Swap in을 실패시킨다. */
+};
+
+void zswap_init(size_t slot_cnt);
+bool zswap_store(size_t slot, const void *page);
+enum zswap_result zswap_load(size_t slot, void *page);
+void zswap_invalidate(size_t slot);
+
+#endif
@@ -45,6 +45,8 @@ __attribute__((always_inline)) static __inline int64_t syscall(uint64_t num_, ui
 
 #define syscall5(NUMBER, ARG0, ARG1, ARG2, ARG3, ARG4) (syscall(((uint64_t)NUMBER), ((uint64_t)ARG0), ((uint64_t)ARG1), ((uint64_t)ARG2), ((uint64_t)ARG3), ((uint64_t)ARG4), 0))
 
+#define syscall6(NUMBER, ARG0, ARG1, ARG2, ARG3, ARG4, ARG5) (syscall(((uint64_t)NUMBER), ((uint64_t)ARG0), ((uint64_t)ARG1), ((uint64_t)ARG2), ((uint64_t)ARG3), ((uint64_t)ARG4), ((uint64_t)ARG5)))
+
 void halt(void) {
     syscall0(SYS_HALT);
     NOT_REACHED();
@@ -111,10 +113,42 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
     return (void *)syscall5(SYS_MMAP, addr, length, writable, fd, offset);
 }
 
+void *mmap_flags(void *addr, size_t length, int writable, int fd, off_t offset, int flags) {
+    return (void *)syscall6(SYS_MMAP, addr, length, writable, fd, offset, flags);
+}
+
 void munmap(void *addr) {
     syscall1(SYS_MUNMAP, addr);
 }
 
+int msync(void *addr, size_t length, int flags) {
+    return syscall3(SYS_MSYNC, addr, length, flags);
+}
+
+int madvise(void *addr, size_t length, int advice) {
+    return syscall3(SYS_MADVISE, addr, length, advice);
+}
+
+int mincore(void *addr, size_t length, unsigned char *vec) {
+    return syscall3(SYS_MINCORE, addr, length, vec);
+}
+
+int mlock(void *addr, size_t length) {
+    return syscall2(SYS_MLOCK, addr, length);
+}
+
+int munlock(void *addr, size_t length) {
+    return syscall2(SYS_MUNLOCK, addr, length);
+}
+
+int mlockall(int flags) {
+    return syscall1(SYS_MLOCKALL, flags);
+}
+
+int munlockall(void) {
+    return syscall0(SYS_MUNLOCKALL);
+}
+
 bool chdir(const char *dir) {
     return syscall1(SYS_CHDIR, dir);
 }
@@ -146,3 +180,7 @@ int mount(const char *path, int chan_no, int dev_no) {
 int umount(const char *path) {
     return syscall1(SYS_UMOUNT, path);
 }
+
+int clone(const char *src, const char *dst) {
+    return syscall2(SYS_CLONE, src, dst);
+}
@@ -0,0 +1,24 @@
+/* Tries clones that clone() must refuse. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (mkdir ("tmp"), "mkdir \"tmp\"");
+
+  CHECK (clone ("missing", "b") == -1, "clone \"missing\" (must return -1)");
+  CHECK (clone ("a", "d") == -1, "clone onto \"d\" (must return -1)");
+  CHECK (clone ("d", "b") == -1, "clone directory \"d\" (must return -1)");
+
+  CHECK (mount ("tmp", -1, 0) == 0, "mount tmpfs on \"tmp\"");
+  CHECK (clone ("a", "tmp/b") == -1,
+         "clone \"a\" into another volume (must return -1)");
+  CHECK (umount ("tmp") == 0, "umount \"tmp\"");
+
+  CHECK (open ("b") == -1, "open \"b\" (must return -1)");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(clone-bad) begin
+(clone-bad) create "a"
+(clone-bad) mkdir "d"
+(clone-bad) mkdir "tmp"
+(clone-bad) clone "missing" (must return -1)
+(clone-bad) clone onto "d" (must return -1)
+(clone-bad) clone directory "d" (must return -1)
+(clone-bad) mount tmpfs on "tmp"
+(clone-bad) clone "a" into another volume (must return -1)
+(clone-bad) umount "tmp"
+(clone-bad) open "b" (must return -1)
+(clone-bad) end
+EOF
+pass;
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($b) = random_bytes (10000);
+substr ($b, 1000, 100) = 'x' x 100;
+check_archive ({"b" => [$b]});
+pass;
@@ -0,0 +1,44 @@
+/* Clones a file, writes to the clone, and checks that the original
+   keeps its data and that the clone outlives the original. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 10000
+#define PATCH_OFS 1000
+#define PATCH_SIZE 100
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+void
+test_main (void)
+{
+  int fd;
+
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  memcpy (buf_b, buf_a, sizeof buf_b);
+  memset (buf_b + PATCH_OFS, 'x', PATCH_SIZE);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK ((fd = open ("a")) > 1, "open \"a\"");
+  CHECK (write (fd, buf_a, sizeof buf_a) == (int) sizeof buf_a, "write \"a\"");
+  close (fd);
+
+  CHECK (clone ("a", "b") == 0, "clone \"a\" to \"b\"");
+  check_file ("b", buf_a, sizeof buf_a);
+
+  CHECK ((fd = open ("b")) > 1, "open \"b\"");
+  seek (fd, PATCH_OFS);
+  CHECK (write (fd, buf_b + PATCH_OFS, PATCH_SIZE) == PATCH_SIZE, "write \"b\"");
+  close (fd);
+
+  check_file ("a", buf_a, sizeof buf_a);
+  check_file ("b", buf_b, sizeof buf_b);
+
+  CHECK (remove ("a"), "remove \"a\"");
+  check_file ("b", buf_b, sizeof buf_b);
+}
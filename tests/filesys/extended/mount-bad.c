@@ -0,0 +1,29 @@
+/* Tries to mount disks and directories that mount() must refuse,
+   and to unmount directories that have nothing mounted on them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  CHECK (mkdir ("mnt"), "mkdir \"mnt\"");
+  CHECK (create ("file", 0), "create \"file\"");
+
+  CHECK (mount ("mnt", 0, 0) == -1, "mount boot disk (must return -1)");
+  CHECK (mount ("mnt", 0, 1) == -1,
+         "mount file system disk again (must return -1)");
+  CHECK (mount ("mnt", 0, 2) == -1, "mount bad device (must return -1)");
+  CHECK (mount ("mnt", 2, 0) == -1, "mount bad channel (must return -1)");
+  CHECK (mount ("mnt", -2, 0) == -1,
+         "mount negative channel (must return -1)");
+  CHECK (mount ("file", -1, 0) == -1,
+         "mount on \"file\" (must return -1)");
+  CHECK (mount ("missing", -1, 0) == -1,
+         "mount on \"missing\" (must return -1)");
+
+  CHECK (umount ("mnt") == -1, "umount \"mnt\" (must return -1)");
+  CHECK (umount ("/") == -1, "umount \"/\" (must return -1)");
+  CHECK (umount ("missing") == -1, "umount \"missing\" (must return -1)");
+}
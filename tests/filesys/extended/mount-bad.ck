@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mount-bad) begin
+(mount-bad) mkdir "mnt"
+(mount-bad) create "file"
+(mount-bad) mount boot disk (must return -1)
+(mount-bad) mount file system disk again (must return -1)
+(mount-bad) mount bad device (must return -1)
+(mount-bad) mount bad channel (must return -1)
+(mount-bad) mount negative channel (must return -1)
+(mount-bad) mount on "file" (must return -1)
+(mount-bad) mount on "missing" (must return -1)
+(mount-bad) umount "mnt" (must return -1)
+(mount-bad) umount "/" (must return -1)
+(mount-bad) umount "missing" (must return -1)
+(mount-bad) end
+EOF
+pass;
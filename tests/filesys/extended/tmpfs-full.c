@@ -0,0 +1,42 @@
+/* Fills a tmpfs until a write comes back short, then checks that
+   removing the file gives the space back. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK_SIZE 4096
+#define MAX_CHUNKS 2048 /* 8 MB, more than any tmpfs holds */
+static char buf[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  int fd;
+  int i, n = CHUNK_SIZE;
+
+  memset (buf, 0x5a, sizeof buf);
+
+  CHECK (mkdir ("tmp"), "mkdir \"tmp\"");
+  CHECK (mount ("tmp", -1, 0) == 0, "mount tmpfs on \"tmp\"");
+  CHECK (create ("tmp/big", 0), "create \"tmp/big\"");
+  CHECK ((fd = open ("tmp/big")) > 1, "open \"tmp/big\"");
+
+  msg ("fill \"tmp/big\"");
+  for (i = 0; i < MAX_CHUNKS && n == CHUNK_SIZE; i++)
+    n = write (fd, buf, CHUNK_SIZE);
+  if (n == CHUNK_SIZE)
+    fail ("wrote %d bytes without running out of space", MAX_CHUNKS * CHUNK_SIZE);
+  CHECK (n >= 0 && n < CHUNK_SIZE, "last write came back short");
+  close (fd);
+
+  CHECK (remove ("tmp/big"), "remove \"tmp/big\"");
+  CHECK (create ("tmp/small", 0), "create \"tmp/small\"");
+  CHECK ((fd = open ("tmp/small")) > 1, "open \"tmp/small\"");
+  CHECK (write (fd, buf, CHUNK_SIZE) == CHUNK_SIZE, "write \"tmp/small\"");
+  close (fd);
+  check_file ("tmp/small", buf, CHUNK_SIZE);
+
+  CHECK (umount ("tmp") == 0, "umount \"tmp\"");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(tmpfs-full) begin
+(tmpfs-full) mkdir "tmp"
+(tmpfs-full) mount tmpfs on "tmp"
+(tmpfs-full) create "tmp/big"
+(tmpfs-full) open "tmp/big"
+(tmpfs-full) fill "tmp/big"
+(tmpfs-full) last write came back short
+(tmpfs-full) remove "tmp/big"
+(tmpfs-full) create "tmp/small"
+(tmpfs-full) open "tmp/small"
+(tmpfs-full) write "tmp/small"
+(tmpfs-full) open "tmp/small" for verification
+(tmpfs-full) verified contents of "tmp/small"
+(tmpfs-full) close "tmp/small"
+(tmpfs-full) umount "tmp"
+(tmpfs-full) end
+EOF
+pass;
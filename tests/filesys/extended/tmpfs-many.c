@@ -0,0 +1,51 @@
+/* Mounts tmpfs volumes until mount() refuses, checks that it does
+   refuse well before running the kernel out of memory, and then
+   unmounts them all and mounts one again. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define MAX_TRIES 64
+
+void
+test_main (void)
+{
+  char name[16];
+  int cnt, i;
+
+  msg ("mount tmpfs volumes until mount fails");
+  for (cnt = 0; cnt < MAX_TRIES; cnt++)
+    {
+      snprintf (name, sizeof name, "t%d", cnt);
+      if (!mkdir (name))
+        fail ("mkdir \"%s\"", name);
+      if (mount (name, -1, 0) != 0)
+        break;
+    }
+  if (cnt == 0)
+    fail ("could not mount any tmpfs");
+  if (cnt == MAX_TRIES)
+    fail ("mounted %d tmpfs volumes without hitting a limit", MAX_TRIES);
+
+  msg ("umount all tmpfs volumes");
+  for (i = 0; i < cnt; i++)
+    {
+      snprintf (name, sizeof name, "t%d", i);
+      if (umount (name) != 0)
+        fail ("umount \"%s\"", name);
+    }
+
+  snprintf (name, sizeof name, "t%d", cnt);
+  CHECK (mount (name, -1, 0) == 0, "mount tmpfs after umount");
+  CHECK (umount (name) == 0, "umount it");
+
+  msg ("remove mount points");
+  for (i = 0; i <= cnt; i++)
+    {
+      snprintf (name, sizeof name, "t%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+}
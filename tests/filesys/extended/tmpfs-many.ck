@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(tmpfs-many) begin
+(tmpfs-many) mount tmpfs volumes until mount fails
+(tmpfs-many) umount all tmpfs volumes
+(tmpfs-many) mount tmpfs after umount
+(tmpfs-many) umount it
+(tmpfs-many) remove mount points
+(tmpfs-many) end
+EOF
+pass;
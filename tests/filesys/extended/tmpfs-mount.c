@@ -0,0 +1,36 @@
+/* Mounts a tmpfs, writes a file into it, and checks that the file
+   is gone after umount and that a fresh tmpfs starts out empty. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 5678
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (mkdir ("tmp"), "mkdir \"tmp\"");
+  CHECK (mount ("tmp", -1, 0) == 0, "mount tmpfs on \"tmp\"");
+  CHECK (mount ("tmp", -1, 0) == -1, "mount tmpfs on \"tmp\" again (must return -1)");
+
+  CHECK (create ("tmp/a", 0), "create \"tmp/a\"");
+  CHECK ((fd = open ("tmp/a")) > 1, "open \"tmp/a\"");
+  CHECK (write (fd, buf, sizeof buf) == (int) sizeof buf, "write \"tmp/a\"");
+  close (fd);
+  check_file ("tmp/a", buf, sizeof buf);
+
+  CHECK (umount ("tmp") == 0, "umount \"tmp\"");
+  CHECK (open ("tmp/a") == -1, "open \"tmp/a\" (must return -1)");
+
+  CHECK (mount ("tmp", -1, 0) == 0, "mount tmpfs on \"tmp\" again");
+  CHECK (open ("tmp/a") == -1, "open \"tmp/a\" (must return -1)");
+  CHECK (umount ("tmp") == 0, "umount \"tmp\"");
+}
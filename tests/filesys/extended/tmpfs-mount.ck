@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(tmpfs-mount) begin
+(tmpfs-mount) mkdir "tmp"
+(tmpfs-mount) mount tmpfs on "tmp"
+(tmpfs-mount) mount tmpfs on "tmp" again (must return -1)
+(tmpfs-mount) create "tmp/a"
+(tmpfs-mount) open "tmp/a"
+(tmpfs-mount) write "tmp/a"
+(tmpfs-mount) open "tmp/a" for verification
+(tmpfs-mount) verified contents of "tmp/a"
+(tmpfs-mount) close "tmp/a"
+(tmpfs-mount) umount "tmp"
+(tmpfs-mount) open "tmp/a" (must return -1)
+(tmpfs-mount) mount tmpfs on "tmp" again
+(tmpfs-mount) open "tmp/a" (must return -1)
+(tmpfs-mount) umount "tmp"
+(tmpfs-mount) end
+EOF
+pass;
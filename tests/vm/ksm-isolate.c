@@ -0,0 +1,73 @@
+/* Gives two processes pages with identical contents so that ksmd can
+   merge them into one frame, then writes to the page in the child,
+   once through read() and once with a plain store, and checks that
+   the parent's copy does not change. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MERGE_TRIES 1024
+
+static char page[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static char scratch[PAGE_SIZE];
+
+/* ksmd runs at the lowest priority, so it only gets the CPU while
+   this process blocks on the disk.  Stops early once the frame
+   behind PAGE changes, that is, once the page has been merged. */
+static void
+wait_for_merge (void)
+{
+  void *pa = get_phys_addr (page);
+  int handle;
+  int i;
+
+  if ((handle = open ("large.txt")) < 2)
+    fail ("open \"large.txt\"");
+  for (i = 0; i < MERGE_TRIES && get_phys_addr (page) == pa; i++)
+    {
+      seek (handle, 0);
+      read (handle, scratch, sizeof scratch);
+    }
+  close (handle);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  pid_t child;
+  size_t i;
+
+  memset (page, 'k', PAGE_SIZE);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      /* Breaks copy-on-write: both processes now own a frame with the
+         same contents. */
+      memset (page, 'k', PAGE_SIZE);
+      wait_for_merge ();
+
+      CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+      CHECK (read (handle, page, strlen (sample)) == (int) strlen (sample),
+             "read \"sample.txt\" into page");
+      close (handle);
+      page[PAGE_SIZE - 1] = 'c';
+
+      if (memcmp (page, sample, strlen (sample)) || page[PAGE_SIZE - 1] != 'c')
+        fail ("child page has bad data");
+      msg ("child page changed");
+      exit (0);
+    }
+  CHECK (wait (child) == 0, "wait for child");
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (page[i] != 'k')
+      fail ("byte %zu of parent page has value %02hhx (should be %02hhx)",
+            i, page[i], 'k');
+  msg ("parent page unchanged");
+}
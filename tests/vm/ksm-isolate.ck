@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-isolate) begin
+(ksm-isolate) open "sample.txt"
+(ksm-isolate) read "sample.txt" into page
+(ksm-isolate) child page changed
+(ksm-isolate) wait for child
+(ksm-isolate) parent page unchanged
+(ksm-isolate) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Passes madvise and mincore unknown advice and ranges that are
+   unaligned, not mapped, in kernel space, or wrap around the end
+   of the address space, and asks madvise to drop a locked page.
+   Each call must return -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+
+static unsigned char vec[4];
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+
+  CHECK (madvise (map, PAGE_SIZE, 5) == -1, "madvise unknown advice");
+  CHECK (madvise (map, PAGE_SIZE, -1) == -1, "madvise negative advice");
+  CHECK (madvise (map + 1, PAGE_SIZE, MADV_NORMAL) == -1,
+         "madvise unaligned address");
+  CHECK (madvise (NULL, PAGE_SIZE, MADV_NORMAL) == -1, "madvise NULL");
+  CHECK (madvise (map, PAGE_SIZE * 2, MADV_DONTNEED) == -1,
+         "madvise past end of mapping");
+  CHECK (madvise ((void *) 0x8004000000, PAGE_SIZE, MADV_NORMAL) == -1,
+         "madvise kernel address");
+  CHECK (madvise (map, (size_t) -PAGE_SIZE, MADV_DONTNEED) == -1,
+         "madvise wrapping range");
+  CHECK (mlock (map, PAGE_SIZE) == 0, "mlock mapping");
+  CHECK (madvise (map, PAGE_SIZE, MADV_DONTNEED) == -1,
+         "madvise drop locked page");
+  CHECK (munlock (map, PAGE_SIZE) == 0, "munlock mapping");
+
+  CHECK (mincore (map + 1, PAGE_SIZE, vec) == -1, "mincore unaligned address");
+  CHECK (mincore (NULL, PAGE_SIZE, vec) == -1, "mincore NULL");
+  CHECK (mincore (map, PAGE_SIZE * 2, vec) == -1,
+         "mincore past end of mapping");
+  CHECK (mincore ((void *) 0x8004000000, PAGE_SIZE, vec) == -1,
+         "mincore kernel address");
+  CHECK (mincore (map, (size_t) -PAGE_SIZE, vec) == -1,
+         "mincore wrapping range");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-bad) begin
+(madvise-bad) open "sample.txt"
+(madvise-bad) mmap "sample.txt"
+(madvise-bad) madvise unknown advice
+(madvise-bad) madvise negative advice
+(madvise-bad) madvise unaligned address
+(madvise-bad) madvise NULL
+(madvise-bad) madvise past end of mapping
+(madvise-bad) madvise kernel address
+(madvise-bad) madvise wrapping range
+(madvise-bad) mlock mapping
+(madvise-bad) madvise drop locked page
+(madvise-bad) munlock mapping
+(madvise-bad) mincore unaligned address
+(madvise-bad) mincore NULL
+(madvise-bad) mincore past end of mapping
+(madvise-bad) mincore kernel address
+(madvise-bad) mincore wrapping range
+(madvise-bad) end
+EOF
+pass;
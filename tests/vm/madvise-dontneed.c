@@ -0,0 +1,57 @@
+/* Drops dirty pages with MADV_DONTNEED and checks that they are
+   refilled from their backing store on the next access: a file
+   mapping keeps the data it was written with, an anonymous page
+   reads back as zero. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+#define CHANGED 16
+
+static char bss[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  int handle, reader;
+  char *map;
+  char buf[1024];
+  unsigned char vec;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  memset (map, 'x', CHANGED);
+  CHECK (madvise (map, PAGE_SIZE, MADV_DONTNEED) == 0,
+         "madvise MADV_DONTNEED on file mapping");
+  CHECK (mincore (map, PAGE_SIZE, &vec) == 0 && vec == 0,
+         "file page is no longer resident");
+
+  /* The dirty data must have been written back before the drop. */
+  CHECK ((reader = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK (read (reader, buf, strlen (sample)) == (int) strlen (sample),
+         "read \"sample.txt\"");
+  close (reader);
+  for (i = 0; i < CHANGED; i++)
+    if (buf[i] != 'x' || map[i] != 'x')
+      fail ("byte %zu lost the write made before MADV_DONTNEED", i);
+  if (memcmp (map + CHANGED, sample + CHANGED, strlen (sample) - CHANGED))
+    fail ("refilled file page has bad data");
+  msg ("file page refilled with written data");
+  munmap (map);
+  close (handle);
+
+  memset (bss, 'y', PAGE_SIZE);
+  CHECK (madvise (bss, PAGE_SIZE, MADV_DONTNEED) == 0,
+         "madvise MADV_DONTNEED on anonymous page");
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (bss[i] != 0)
+      fail ("byte %zu of anonymous page is %02hhx (should be 0)", i, bss[i]);
+  msg ("anonymous page refilled with zeros");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-dontneed) begin
+(madvise-dontneed) open "sample.txt"
+(madvise-dontneed) mmap "sample.txt"
+(madvise-dontneed) madvise MADV_DONTNEED on file mapping
+(madvise-dontneed) file page is no longer resident
+(madvise-dontneed) open "sample.txt" again
+(madvise-dontneed) read "sample.txt"
+(madvise-dontneed) file page refilled with written data
+(madvise-dontneed) madvise MADV_DONTNEED on anonymous page
+(madvise-dontneed) anonymous page refilled with zeros
+(madvise-dontneed) end
+EOF
+pass;
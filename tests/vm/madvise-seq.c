@@ -0,0 +1,47 @@
+/* Maps part of a large file with each access advice in turn and
+   checks that every page still reads back the same data as read(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+#define PAGE_CNT 64
+
+static char buf[PAGE_SIZE];
+
+static void
+check_mapping (int advice, const char *name)
+{
+  int handle;
+  char *map;
+  size_t i;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE * PAGE_CNT, 0, handle, 0))
+         != MAP_FAILED, "mmap \"large.txt\"");
+  CHECK (madvise (map, PAGE_SIZE * PAGE_CNT, advice) == 0,
+         "madvise %s", name);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      if (read (handle, buf, PAGE_SIZE) != PAGE_SIZE)
+        fail ("read page %zu of \"large.txt\"", i);
+      if (memcmp (map + i * PAGE_SIZE, buf, PAGE_SIZE))
+        fail ("page %zu read through %s mapping has bad data", i, name);
+    }
+  msg ("compare %s mapping against read data", name);
+
+  munmap (map);
+  close (handle);
+}
+
+void
+test_main (void)
+{
+  check_mapping (MADV_SEQUENTIAL, "MADV_SEQUENTIAL");
+  check_mapping (MADV_RANDOM, "MADV_RANDOM");
+  check_mapping (MADV_NORMAL, "MADV_NORMAL");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-seq) begin
+(madvise-seq) open "large.txt"
+(madvise-seq) mmap "large.txt"
+(madvise-seq) madvise MADV_SEQUENTIAL
+(madvise-seq) compare MADV_SEQUENTIAL mapping against read data
+(madvise-seq) open "large.txt"
+(madvise-seq) mmap "large.txt"
+(madvise-seq) madvise MADV_RANDOM
+(madvise-seq) compare MADV_RANDOM mapping against read data
+(madvise-seq) open "large.txt"
+(madvise-seq) mmap "large.txt"
+(madvise-seq) madvise MADV_NORMAL
+(madvise-seq) compare MADV_NORMAL mapping against read data
+(madvise-seq) end
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* Checks the residency mincore reports for a file mapping: no page
+   is resident before the first access, a page is resident once it
+   has been read, and every page is resident after MADV_WILLNEED. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+#define PAGE_CNT 32
+#define TOUCHED 20
+
+static unsigned char vec[PAGE_CNT];
+static volatile char sink;
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+  size_t i;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE * PAGE_CNT, 0, handle, 0))
+         != MAP_FAILED, "mmap \"large.txt\"");
+
+  CHECK (mincore (map, PAGE_SIZE * PAGE_CNT, vec) == 0, "mincore");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (vec[i] != 0)
+      fail ("page %zu is resident before it was accessed", i);
+  msg ("no page is resident before access");
+
+  sink = map[TOUCHED * PAGE_SIZE];
+  CHECK (mincore (map, PAGE_SIZE * PAGE_CNT, vec) == 0 && vec[TOUCHED] == 1,
+         "page %d is resident after read", TOUCHED);
+
+  CHECK (madvise (map, PAGE_SIZE * PAGE_CNT, MADV_WILLNEED) == 0,
+         "madvise MADV_WILLNEED");
+  CHECK (mincore (map, PAGE_SIZE * PAGE_CNT, vec) == 0, "mincore");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (vec[i] != 1)
+      fail ("page %zu is not resident after MADV_WILLNEED", i);
+  msg ("every page is resident after MADV_WILLNEED");
+
+  munmap (map);
+  CHECK (mincore (map, PAGE_SIZE, vec) == -1, "mincore after munmap");
+  close (handle);
+}
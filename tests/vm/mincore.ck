@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mincore) begin
+(mincore) open "large.txt"
+(mincore) mmap "large.txt"
+(mincore) mincore
+(mincore) no page is resident before access
+(mincore) page 20 is resident after read
+(mincore) madvise MADV_WILLNEED
+(mincore) mincore
+(mincore) every page is resident after MADV_WILLNEED
+(mincore) mincore after munmap
+(mincore) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Passes mlock and munlock ranges that are NULL, in kernel space,
+   wrap around the end of the address space, are not mapped, or
+   exceed the per-process limit.  Each call must return -1 and
+   leave no page locked. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+
+/* Pages a process may lock (MLOCK_LIMIT in the kernel). */
+#define LOCK_LIMIT 64
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE * (LOCK_LIMIT + 1), 0, handle, 0))
+         != MAP_FAILED, "mmap \"large.txt\"");
+
+  CHECK (mlock (NULL, PAGE_SIZE) == -1, "mlock NULL");
+  CHECK (mlock ((void *) 0x8004000000, PAGE_SIZE) == -1,
+         "mlock kernel address");
+  CHECK (mlock (map, (size_t) -1) == -1, "mlock wrapping range");
+  CHECK (mlock (map + PAGE_SIZE * (LOCK_LIMIT + 1), PAGE_SIZE) == -1,
+         "mlock unmapped address");
+  CHECK (mlock (map, PAGE_SIZE * (LOCK_LIMIT + 2)) == -1,
+         "mlock past end of mapping");
+  CHECK (mlock (map, PAGE_SIZE * (LOCK_LIMIT + 1)) == -1,
+         "mlock more than %d pages", LOCK_LIMIT);
+
+  CHECK (munlock (NULL, PAGE_SIZE) == -1, "munlock NULL");
+  CHECK (munlock ((void *) 0x8004000000, PAGE_SIZE) == -1,
+         "munlock kernel address");
+  CHECK (munlock (map, (size_t) -1) == -1, "munlock wrapping range");
+  CHECK (munlock (map + PAGE_SIZE * (LOCK_LIMIT + 1), PAGE_SIZE) == -1,
+         "munlock unmapped address");
+
+  /* A failed mlock must not have used up any of the limit. */
+  CHECK (mlock (map, PAGE_SIZE * LOCK_LIMIT) == 0,
+         "mlock %d pages", LOCK_LIMIT);
+  CHECK (munlock (map, PAGE_SIZE * LOCK_LIMIT) == 0,
+         "munlock %d pages", LOCK_LIMIT);
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock-bad) begin
+(mlock-bad) open "large.txt"
+(mlock-bad) mmap "large.txt"
+(mlock-bad) mlock NULL
+(mlock-bad) mlock kernel address
+(mlock-bad) mlock wrapping range
+(mlock-bad) mlock unmapped address
+(mlock-bad) mlock past end of mapping
+(mlock-bad) mlock more than 64 pages
+(mlock-bad) munlock NULL
+(mlock-bad) munlock kernel address
+(mlock-bad) munlock wrapping range
+(mlock-bad) munlock unmapped address
+(mlock-bad) mlock 64 pages
+(mlock-bad) munlock 64 pages
+(mlock-bad) end
+EOF
+pass;
@@ -0,0 +1,66 @@
+/* Locks part of a file mapping, starting from an unaligned address,
+   and checks that every page the range touches is resident and reads
+   back the file's data.  Then locks up to the per-process limit. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+#define PAGE_CNT 8
+
+/* Pages a process may lock (MLOCK_LIMIT in the kernel). */
+#define LOCK_LIMIT 64
+
+static char buf[PAGE_SIZE];
+static unsigned char vec[PAGE_CNT];
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+  size_t i;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE * PAGE_CNT, 0, handle, 0))
+         != MAP_FAILED, "mmap \"large.txt\"");
+
+  /* [map + 100, map + 100 + 3 pages) touches pages 0 through 3. */
+  CHECK (mlock (map + 100, PAGE_SIZE * 3) == 0, "mlock unaligned range");
+  CHECK (mlock (map, PAGE_SIZE) == 0, "mlock locked page again");
+  CHECK (mincore (map, PAGE_SIZE * PAGE_CNT, vec) == 0, "mincore");
+  for (i = 0; i < 4; i++)
+    if (vec[i] != 1)
+      fail ("locked page %zu is not resident", i);
+  msg ("locked pages are resident");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      if (read (handle, buf, PAGE_SIZE) != PAGE_SIZE)
+        fail ("read page %zu of \"large.txt\"", i);
+      if (memcmp (map + i * PAGE_SIZE, buf, PAGE_SIZE))
+        fail ("page %zu has bad data", i);
+    }
+  msg ("compare mapped data against read data");
+
+  CHECK (munlock (map + 100, PAGE_SIZE * 3) == 0, "munlock");
+  CHECK (munlock (map, PAGE_SIZE * PAGE_CNT) == 0, "munlock unlocked pages");
+  munmap (map);
+
+  /* Every page unlocked above, so the whole limit is available. */
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE * (LOCK_LIMIT + 1), 0, handle, 0))
+         != MAP_FAILED, "mmap %d pages of \"large.txt\"", LOCK_LIMIT + 1);
+  CHECK (mlock (map, PAGE_SIZE * LOCK_LIMIT) == 0,
+         "mlock %d pages", LOCK_LIMIT);
+  CHECK (mlock (map + PAGE_SIZE * LOCK_LIMIT, PAGE_SIZE) == -1,
+         "mlock past the limit fails");
+  CHECK (munlock (map, PAGE_SIZE * LOCK_LIMIT) == 0,
+         "munlock %d pages", LOCK_LIMIT);
+  CHECK (mlock (map + PAGE_SIZE * LOCK_LIMIT, PAGE_SIZE) == 0,
+         "mlock after munlock");
+  munmap (map);
+  close (handle);
+}
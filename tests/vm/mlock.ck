@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock) begin
+(mlock) open "large.txt"
+(mlock) mmap "large.txt"
+(mlock) mlock unaligned range
+(mlock) mlock locked page again
+(mlock) mincore
+(mlock) locked pages are resident
+(mlock) compare mapped data against read data
+(mlock) munlock
+(mlock) munlock unlocked pages
+(mlock) mmap 65 pages of "large.txt"
+(mlock) mlock 64 pages
+(mlock) mlock past the limit fails
+(mlock) munlock 64 pages
+(mlock) mlock after munlock
+(mlock) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Checks mlockall and munlockall: bad flags are rejected,
+   MCL_CURRENT brings every mapped page in, MCL_FUTURE keeps later
+   mappings working, and munlockall releases everything so the pages
+   can be locked again. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+  unsigned char vec;
+
+  CHECK (mlockall (0) == -1, "mlockall with no flags");
+  CHECK (mlockall (4) == -1, "mlockall with unknown flag");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  CHECK (mlockall (MCL_CURRENT) == 0, "mlockall MCL_CURRENT");
+  CHECK (mincore (map, PAGE_SIZE, &vec) == 0 && vec == 1,
+         "mapped page is resident");
+  if (memcmp (map, sample, strlen (sample)))
+    fail ("locked page has bad data");
+  msg ("locked page has file data");
+  CHECK (munlockall () == 0, "munlockall");
+  munmap (map);
+
+  CHECK (mlockall (MCL_CURRENT | MCL_FUTURE) == 0,
+         "mlockall MCL_CURRENT | MCL_FUTURE");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\" again");
+  map[0] = 'x';
+  if (map[0] != 'x' || memcmp (map + 1, sample + 1, strlen (sample) - 1))
+    fail ("page mapped after MCL_FUTURE has bad data");
+  msg ("write to page mapped after MCL_FUTURE");
+  CHECK (munlockall () == 0, "munlockall");
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlockall) begin
+(mlockall) mlockall with no flags
+(mlockall) mlockall with unknown flag
+(mlockall) open "sample.txt"
+(mlockall) mmap "sample.txt"
+(mlockall) mlockall MCL_CURRENT
+(mlockall) mapped page is resident
+(mlockall) locked page has file data
+(mlockall) munlockall
+(mlockall) mlockall MCL_CURRENT | MCL_FUTURE
+(mlockall) mmap "sample.txt" again
+(mlockall) write to page mapped after MCL_FUTURE
+(mlockall) munlockall
+(mlockall) end
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Passes mmap_flags an unknown flag, and MAP_POPULATE a range that
+   overlaps an existing mapping.  Both must fail and leave the
+   existing mapping intact. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap_flags (ACTUAL, PAGE_SIZE, 0, handle, 0, 0x4000) == MAP_FAILED,
+         "try to mmap with unknown flag");
+  CHECK ((map = mmap (ACTUAL, PAGE_SIZE, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  CHECK (mmap_flags (ACTUAL - PAGE_SIZE, PAGE_SIZE * 2, 0, handle, 0,
+                     MAP_POPULATE) == MAP_FAILED,
+         "try to mmap overlapping range with MAP_POPULATE");
+  if (memcmp (map, sample, strlen (sample)))
+    fail ("existing mapping has bad data");
+  msg ("existing mapping is intact");
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-populate-bad) begin
+(mmap-populate-bad) open "sample.txt"
+(mmap-populate-bad) try to mmap with unknown flag
+(mmap-populate-bad) mmap "sample.txt"
+(mmap-populate-bad) try to mmap overlapping range with MAP_POPULATE
+(mmap-populate-bad) existing mapping is intact
+(mmap-populate-bad) end
+EOF
+pass;
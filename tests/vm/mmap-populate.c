@@ -0,0 +1,76 @@
+/* Maps files with MAP_POPULATE and checks that every page is
+   resident as soon as mmap returns, holds the file's data, and that
+   a populated writable mapping still writes back on munmap. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define PAGE_SIZE 4096
+#define PAGE_CNT 16
+
+static char buf[PAGE_SIZE];
+static unsigned char vec[PAGE_CNT];
+
+static void
+check_resident (const char *map, size_t page_cnt, const char *name)
+{
+  size_t i;
+
+  CHECK (mincore ((void *) map, page_cnt * PAGE_SIZE, vec) == 0,
+         "mincore \"%s\"", name);
+  for (i = 0; i < page_cnt; i++)
+    if (vec[i] != 1)
+      fail ("page %zu of \"%s\" is not resident after MAP_POPULATE",
+            i, name);
+  msg ("every page of \"%s\" is resident", name);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+  size_t i;
+
+  /* Read-only mapping of a large file. */
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap_flags (ACTUAL, PAGE_SIZE * PAGE_CNT, 0, handle, 0,
+                            MAP_POPULATE)) != MAP_FAILED,
+         "mmap \"large.txt\" with MAP_POPULATE");
+  check_resident (map, PAGE_CNT, "large.txt");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      if (read (handle, buf, PAGE_SIZE) != PAGE_SIZE)
+        fail ("read page %zu of \"large.txt\"", i);
+      if (memcmp (map + i * PAGE_SIZE, buf, PAGE_SIZE))
+        fail ("populated page %zu has bad data", i);
+    }
+  msg ("compare populated data against read data");
+  munmap (map);
+  close (handle);
+
+  /* Writable mapping of a file shorter than a page. */
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap_flags (ACTUAL, PAGE_SIZE, 1, handle, 0, MAP_POPULATE))
+         != MAP_FAILED, "mmap \"sample.txt\" with MAP_POPULATE");
+  check_resident (map, 1, "sample.txt");
+  if (memcmp (map, sample, strlen (sample)))
+    fail ("populated page has bad data");
+  for (i = strlen (sample); i < PAGE_SIZE; i++)
+    if (map[i] != 0)
+      fail ("byte %zu past end of file is %02hhx (should be 0)", i, map[i]);
+  msg ("populated page is zero past end of file");
+
+  map[0] = 'x';
+  munmap (map);
+  CHECK (read (handle, buf, strlen (sample)) == (int) strlen (sample),
+         "read \"sample.txt\"");
+  if (buf[0] != 'x' || memcmp (buf + 1, sample + 1, strlen (sample) - 1))
+    fail ("write through populated mapping was not written back");
+  msg ("compare read data against written data");
+  close (handle);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-populate) begin
+(mmap-populate) open "large.txt"
+(mmap-populate) mmap "large.txt" with MAP_POPULATE
+(mmap-populate) mincore "large.txt"
+(mmap-populate) every page of "large.txt" is resident
+(mmap-populate) compare populated data against read data
+(mmap-populate) open "sample.txt"
+(mmap-populate) mmap "sample.txt" with MAP_POPULATE
+(mmap-populate) mincore "sample.txt"
+(mmap-populate) every page of "sample.txt" is resident
+(mmap-populate) populated page is zero past end of file
+(mmap-populate) read "sample.txt"
+(mmap-populate) compare read data against written data
+(mmap-populate) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Passes msync bad flags and ranges that are unaligned, not
+   mapped, not a file mapping, or wrap around the end of the
+   address space.  Each call must return -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+static char data[4096] __attribute__ ((aligned (4096)));
+
+void
+test_main (void)
+{
+  int handle;
+  char *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, 4096, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+
+  CHECK (msync (map, 4096, MS_ASYNC | MS_SYNC) == -1,
+         "msync with MS_ASYNC and MS_SYNC");
+  CHECK (msync (map, 4096, 8) == -1, "msync with unknown flag");
+  CHECK (msync (map + 1, 4096, MS_SYNC) == -1, "msync unaligned address");
+  CHECK (msync (NULL, 4096, MS_SYNC) == -1, "msync NULL");
+  CHECK (msync (map, 8192, MS_SYNC) == -1, "msync past end of mapping");
+  CHECK (msync (map + 0x100000, 4096, MS_SYNC) == -1,
+         "msync unmapped address");
+  data[0] = 1;
+  CHECK (msync (data, 4096, MS_SYNC) == -1, "msync non-file memory");
+  CHECK (msync ((void *) 0x8004000000, 4096, MS_SYNC) == -1,
+         "msync kernel address");
+  CHECK (msync (map, (size_t) -4096, MS_SYNC) == -1,
+         "msync wrapping range");
+
+  munmap (map);
+  CHECK (msync (map, 4096, MS_SYNC) == -1, "msync after munmap");
+  close (handle);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync-bad) begin
+(msync-bad) open "sample.txt"
+(msync-bad) mmap "sample.txt"
+(msync-bad) msync with MS_ASYNC and MS_SYNC
+(msync-bad) msync with unknown flag
+(msync-bad) msync unaligned address
+(msync-bad) msync NULL
+(msync-bad) msync past end of mapping
+(msync-bad) msync unmapped address
+(msync-bad) msync non-file memory
+(msync-bad) msync kernel address
+(msync-bad) msync wrapping range
+(msync-bad) msync after munmap
+(msync-bad) end
+EOF
+pass;
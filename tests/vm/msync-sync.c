@@ -0,0 +1,43 @@
+/* Writes to a file through a mapping and flushes it with msync,
+   then reads the file back with read() while the mapping is still
+   in place to verify that MS_SYNC wrote the data back. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+#define CHANGED 16
+
+void
+test_main (void)
+{
+  int handle, reader;
+  char *map;
+  char buf[1024];
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, 4096, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  memset (map, 'x', CHANGED);
+  CHECK (msync (map, 4096, MS_ASYNC) == 0, "msync MS_ASYNC");
+  CHECK (msync (map, 4096, MS_SYNC | MS_INVALIDATE) == 0, "msync MS_SYNC");
+
+  /* Read back via read() before unmapping. */
+  CHECK ((reader = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK (read (reader, buf, strlen (sample)) == (int) strlen (sample),
+         "read \"sample.txt\"");
+  for (i = 0; i < CHANGED; i++)
+    if (buf[i] != 'x')
+      fail ("byte %zu of file is %02hhx (should be 'x')", i, buf[i]);
+  if (memcmp (buf + CHANGED, sample + CHANGED, strlen (sample) - CHANGED))
+    fail ("msync changed bytes it was not asked to write");
+  msg ("compare read data against written data");
+  close (reader);
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync-sync) begin
+(msync-sync) open "sample.txt"
+(msync-sync) mmap "sample.txt"
+(msync-sync) msync MS_ASYNC
+(msync-sync) msync MS_SYNC
+(msync-sync) open "sample.txt" again
+(msync-sync) read "sample.txt"
+(msync-sync) compare read data against written data
+(msync-sync) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Reads a file into a zero-fill page that has only been read so
+   far, then checks that the shared zero page was not overwritten:
+   other untouched zero-fill pages must still read as zero, both in
+   this process and in a forked child. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static char fresh[PAGE_SIZE * 2] __attribute__ ((aligned (PAGE_SIZE)));
+
+static void
+check_zero (const char *page, const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    if (page[i] != 0)
+      fail ("byte %zu of %s has value %02hhx (should be 0)",
+            i, name, page[i]);
+  msg ("%s is still zero", name);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  pid_t child;
+
+  CHECK (buf[0] == 0 && fresh[0] == 0, "read zero-fill pages");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, strlen (sample)) == (int) strlen (sample),
+         "read \"sample.txt\" into zero-fill page");
+  close (handle);
+
+  if (memcmp (buf, sample, strlen (sample)))
+    fail ("read into zero-fill page reported bad data");
+  check_zero (fresh, "zero-fill page");
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      check_zero (fresh + PAGE_SIZE, "child zero-fill page");
+      exit (0);
+    }
+  CHECK (wait (child) == 0, "wait for child");
+}
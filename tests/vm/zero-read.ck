@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-read) begin
+(zero-read) read zero-fill pages
+(zero-read) open "sample.txt"
+(zero-read) read "sample.txt" into zero-fill page
+(zero-read) zero-fill page is still zero
+(zero-read) child zero-fill page is still zero
+(zero-read) wait for child
+(zero-read) end
+EOF
+pass;
@@ -142,26 +142,38 @@ static void bss_init(void) {
  * 도록 CPU를 설정합니다.
  * base_pml4부터 pml4를 가리킵니다. */
 static void paging_init(uint64_t mem_end) {
-    uint64_t *pml4, *pte;
+    uint64_t *pml4, *pte, *pde;
     int perm;
     pml4 = base_pml4 = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 
     extern char start, _end_kernel_text;
     // Maps physical address [0 ~ mem_end] to
     //   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-    for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+    for (uint64_t pa = 0; pa < mem_end;) {
         uint64_t va = (uint64_t)ptov(pa);
 
+        /** Project 3: Large Page - 2MB 정렬된 구간은 PDE 하나로 매핑해 page table과 TLB entry를 아낀다.
+         * 읽기 전용이어야 하는 kernel text와 겹치는 구간만 4KB page로 남긴다. */
+        if (pa % LARGE_PGSIZE == 0 && pa + LARGE_PGSIZE <= mem_end &&
+            (va + LARGE_PGSIZE <= (uint64_t)&start || (uint64_t)&_end_kernel_text <= va)) {
+            if ((pde = pde_walk(pml4, va, 1)) != NULL)
+                *pde = pa | PTE_PS | PTE_P | PTE_W;
+            pa += LARGE_PGSIZE;
+            continue;
+        }
+
         perm = PTE_P | PTE_W;
         if ((uint64_t)&start <= va && va < (uint64_t)&_end_kernel_text)
             perm &= ~PTE_W;
 
         if ((pte = pml4e_walk(pml4, va, 1)) != NULL)
             *pte = pa | perm;
+        pa += PGSIZE;
     }
 
     // reload cr3
     pml4_activate(0);
+    pcid_init();
 }
 
 /* 커널 명령줄을 단어로 나누고 이를 argv와 같은 배열로 반환합니다. */
@@ -220,6 +232,12 @@ static char **parse_options(char **argv) {
             user_page_limit = atoi(value);
         else if (!strcmp(name, "-threads-tests"))
             thread_tests = true;
+#endif
+#ifdef VM
+        else if (!strcmp(name, "-ksm"))
+            ksm_scan_pages = atoi(value);
+        else if (!strcmp(name, "-stack"))
+            stack_prefault_pages = atoi(value);
 #endif
         else
             PANIC("unknown option `%s' (use -h for help)", name);
@@ -315,6 +333,10 @@ static void usage(void) {
         "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
         "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+        "  -ksm=COUNT         Scan COUNT frames per 100 ms for merging (0=off).\n"
+        "  -stack=COUNT       Map COUNT extra stack pages at process start.\n"
 #endif
     );
     power_off();
@@ -347,4 +369,7 @@ static void print_stats(void) {
 #ifdef USERPROG
     exception_print_stats();
 #endif
+#ifdef VM
+    ksm_print_stats();
+#endif
 }
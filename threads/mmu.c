@@ -6,10 +6,101 @@
 
 #include "intrinsic.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 
+/** Project 3: PCID - 최근에 실행한 address space들의 TLB entry를 PCID로 구분해 CR3를 바꿔도 남겨 둔다.
+ * PCID 0은 base_pml4가 쓰고, user pml4는 1..PCID_SLOTS를 돌아가며 받는다. */
+#define PCID_SLOTS 16
+#define CR3_NOFLUSH (1ULL << 63)
+#define CR4_PCIDE (1 << 17)
+#define CPUID_1_ECX_PCID (1 << 17)
+#define CPUID_7_EBX_INVPCID (1 << 10)
+
+static bool pcid_enabled;
+static bool invpcid_enabled;
+static uint64_t *pcid_owner[PCID_SLOTS + 1]; /* PCID -> pml4 */
+static bool pcid_stale[PCID_SLOTS + 1];      /* 실행 중이 아닐 때 PTE가 바뀌어 다음 activate에서 flush */
+static unsigned pcid_next;
+
+/** Project 3: PCID - CPU가 지원하면 CR4.PCIDE를 켠다. CR3의 PCID가 0일 때 호출해야 한다. */
+void pcid_init(void) {
+    uint32_t max_leaf, eax, ebx, ecx, edx;
+
+    cpuid(0, 0, &max_leaf, &ebx, &ecx, &edx);
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (!(ecx & CPUID_1_ECX_PCID))
+        return;  // 지원하지 않으면 예전처럼 CR3를 바꿀 때마다 TLB 전체를 버린다.
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+        invpcid_enabled = (ebx & CPUID_7_EBX_INVPCID) != 0;
+    }
+    lcr4(rcr4() | CR4_PCIDE);
+    pcid_enabled = true;
+}
+
+/* PML4가 받은 PCID. 없으면 0. 인터럽트를 끈 상태로 호출 */
+static unsigned pcid_find(uint64_t *pml4) {
+    for (unsigned pcid = 1; pcid <= PCID_SLOTS; pcid++)
+        if (pcid_owner[pcid] == pml4)
+            return pcid;
+    return 0;
+}
+
+/* PML4를 올릴 CR3 값. 처음 받은 PCID거나 stale이면 그 PCID의 entry를 flush 하고, 아니면 남겨 둔다. */
+static uint64_t pcid_cr3(uint64_t *pml4) {
+    unsigned pcid;
+    bool flush = false;
+
+    if (pml4 == base_pml4)  // kernel mapping은 바뀌지 않는다.
+        return vtop(pml4) | CR3_NOFLUSH;
+
+    pcid = pcid_find(pml4);
+    if (pcid == 0) {
+        pcid = pcid_next++ % PCID_SLOTS + 1;  // 가장 오래전에 받은 PCID를 빼앗는다.
+        pcid_owner[pcid] = pml4;
+        flush = true;
+    }
+    if (pcid_stale[pcid]) {
+        pcid_stale[pcid] = false;
+        flush = true;
+    }
+    return vtop(pml4) | pcid | (flush ? 0 : CR3_NOFLUSH);
+}
+
+/** Project 3: PCID - PML4에서 VA의 PTE를 바꾼 뒤 호출. 실행 중인 pml4면 INVLPG,
+ * PCID를 가진 다른 pml4면 INVPCID로 그 entry만 지우거나, 없으면 다음 activate에서 flush 하게 한다. */
+static void pml4_invalidate(uint64_t *pml4, const void *va) {
+    enum intr_level old_level = intr_disable();
+
+    if (PTE_ADDR(rcr3()) == vtop(pml4))
+        invlpg((uint64_t)va);
+    else if (pcid_enabled) {
+        unsigned pcid = pcid_find(pml4);
+        if (pcid != 0 && invpcid_enabled)
+            invpcid(pcid, (uint64_t)va);
+        else if (pcid != 0)
+            pcid_stale[pcid] = true;
+    }
+
+    intr_set_level(old_level);
+}
+
+/** Project 3: THP - user의 2MB PDE를 같은 frame들을 가리키는 4KB PTE 512개로 나눈다.
+ * 한 page만 unmap, COW, evict 할 때 호출되며, 주소 변환은 그대로라 TLB flush는 필요 없다. */
+static void large_page_split(uint64_t *pde) {
+    uint64_t *pt = palloc_get_page(PAL_ASSERT);  // 나누지 못하면 page 하나만 고칠 방법이 없다.
+    uint64_t pa = PTE_ADDR(*pde);
+    uint64_t flags = *pde & PTE_FLAGS & ~(uint64_t)PTE_PS;  // A/D bit도 모든 page로 물려준다.
+
+    for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+        pt[i] = (pa + i * PGSIZE) | flags;
+    *pde = vtop(pt) | PTE_U | PTE_W | PTE_P;
+}
+
 static uint64_t *pgdir_walk(uint64_t *pdp, const uint64_t va, int create) {
     int idx = PDX(va);
     if (pdp) {
@@ -24,6 +115,11 @@ static uint64_t *pgdir_walk(uint64_t *pdp, const uint64_t va, int create) {
             } else
                 return NULL;
         }
+        if (pdp[idx] & PTE_PS) {
+            if (!(pdp[idx] & PTE_U))  // kernel direct map의 2MB page에는 page table이 없다.
+                return NULL;
+            large_page_split(&pdp[idx]);
+        }
         return (uint64_t *)ptov(PTE_ADDR(pdp[idx]) + 8 * PTX(va));
     }
     return NULL;
@@ -87,6 +183,32 @@ uint64_t *pml4e_walk(uint64_t *pml4e, const uint64_t va, int create) {
     return pte;
 }
 
+/** Project 3: THP - PML4에서 VA를 매핑하는 PDE의 주소.
+ * PDPE table이 없으면 CREATE일 때 만들고, 아니면 NULL을 리턴한다. */
+uint64_t *pde_walk(uint64_t *pml4, const uint64_t va, int create) {
+    uint64_t *table = pml4;
+    unsigned idx[2] = {PML4(va), PDPE(va)};
+
+    for (int level = 0; level < 2; level++) {
+        if (!(table[idx[level]] & PTE_P)) {
+            uint64_t *new_page = create ? palloc_get_page(PAL_ZERO) : NULL;
+            if (new_page == NULL)
+                return NULL;
+            table[idx[level]] = vtop(new_page) | PTE_U | PTE_W | PTE_P;
+        }
+        table = ptov(PTE_ADDR(table[idx[level]]));
+    }
+    return &table[PDX(va)];
+}
+
+/* VA가 user의 2MB page로 매핑되어 있으면 그 PDE. 아니면 NULL */
+static uint64_t *large_pde(uint64_t *pml4, const void *va) {
+    uint64_t *pde = pde_walk(pml4, (uint64_t)va, false);
+    uint64_t large = PTE_P | PTE_PS | PTE_U;
+
+    return pde != NULL && (*pde & large) == large ? pde : NULL;
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -113,7 +235,7 @@ static bool pt_for_each(uint64_t *pt, pte_for_each_func *func, void *aux, unsign
 static bool pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux, unsigned pml4_index, unsigned pdp_index) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pte = ptov((uint64_t *)pdp[i]);
-        if (((uint64_t)pte) & PTE_P)
+        if ((((uint64_t)pte) & PTE_P) && !(((uint64_t)pte) & PTE_PS))
             if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux, pml4_index, pdp_index, i))
                 return false;
     }
@@ -123,14 +245,15 @@ static bool pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux, un
 static bool pdp_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux, unsigned pml4_index) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pde = ptov((uint64_t *)pdp[i]);
-        if (((uint64_t)pde) & PTE_P)
+        if ((((uint64_t)pde) & PTE_P) && !(((uint64_t)pde) & PTE_PS))
             if (!pgdir_for_each((uint64_t *)PTE_ADDR(pde), func, aux, pml4_index, i))
                 return false;
     }
     return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * Large page(PTE_PS)로 매핑된 kernel direct map은 PTE가 없으므로 건너뛴다. */
 bool pml4_for_each(uint64_t *pml4, pte_for_each_func *func, void *aux) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pdpe = ptov((uint64_t *)pml4[i]);
@@ -153,7 +276,7 @@ static void pt_destroy(uint64_t *pt) {
 static void pgdir_destroy(uint64_t *pdp) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pte = ptov((uint64_t *)pdp[i]);
-        if (((uint64_t)pte) & PTE_P)
+        if ((((uint64_t)pte) & PTE_P) && !(((uint64_t)pte) & PTE_PS))
             pt_destroy(PTE_ADDR(pte));
     }
     palloc_free_page((void *)pdp);
@@ -174,6 +297,13 @@ void pml4_destroy(uint64_t *pml4) {
         return;
     ASSERT(pml4 != base_pml4);
 
+    /** Project 3: PCID - 같은 주소에 새 pml4가 만들어져도 남은 TLB entry를 쓰지 않도록 PCID를 돌려준다. */
+    enum intr_level old_level = intr_disable();
+    unsigned pcid = pcid_find(pml4);
+    if (pcid != 0)
+        pcid_owner[pcid] = NULL;
+    intr_set_level(old_level);
+
     /* if PML4 (vaddr) >= 1, it's kernel space by define. */
     uint64_t *pdpe = ptov((uint64_t *)pml4[0]);
     if (((uint64_t)pdpe) & PTE_P)
@@ -184,7 +314,17 @@ void pml4_destroy(uint64_t *pml4) {
 /* Loads page directory PD into the CPU's page directory base
  * register. */
 void pml4_activate(uint64_t *pml4) {
-    lcr3(vtop(pml4 ? pml4 : base_pml4));
+    if (pml4 == NULL)
+        pml4 = base_pml4;
+
+    if (!pcid_enabled) {
+        lcr3(vtop(pml4));
+        return;
+    }
+
+    enum intr_level old_level = intr_disable();
+    lcr3(pcid_cr3(pml4));
+    intr_set_level(old_level);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -194,6 +334,10 @@ void pml4_activate(uint64_t *pml4) {
 void *pml4_get_page(uint64_t *pml4, const void *uaddr) {
     ASSERT(is_user_vaddr(uaddr));
 
+    uint64_t *pde = large_pde(pml4, uaddr);
+    if (pde != NULL)
+        return ptov(PTE_ADDR(*pde)) + ((uint64_t)uaddr & (LARGE_PGSIZE - 1));
+
     uint64_t *pte = pml4e_walk(pml4, (uint64_t)uaddr, 0);
 
     if (pte && (*pte & PTE_P))
@@ -217,13 +361,38 @@ bool pml4_set_page(uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
     uint64_t *pte = pml4e_walk(pml4, (uint64_t)upage, 1);
 
-    if (pte)
+    if (pte) {
+        bool was_present = (*pte & PTE_P) != 0;
         // 실제 물리 메모리가 없기 때문에 물리 주소를 흉내낸 Kernel Memory 주소를 할당
         // Present | RW 권한 | User / Kernel
         *pte = vtop(kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+        if (was_present)  // 다른 frame을 가리키던 entry가 TLB에 남지 않도록
+            pml4_invalidate(pml4, upage);
+    }
     return pte != NULL;
 }
 
+/** Project 3: THP - 2MB 정렬된 UPAGE부터 2MB를 연속된 KPAGE로 PDE 하나에 매핑한다.
+ * 그 범위에 이미 page table이 있으면 false. */
+bool pml4_set_large_page(uint64_t *pml4, void *upage, void *kpage, bool rw) {
+    ASSERT((uint64_t)upage % LARGE_PGSIZE == 0);
+    ASSERT((uint64_t)kpage % LARGE_PGSIZE == 0);
+    ASSERT(is_user_vaddr(upage));
+    ASSERT(pml4 != base_pml4);
+
+    uint64_t *pde = pde_walk(pml4, (uint64_t)upage, 1);
+    if (pde == NULL || (*pde & PTE_P))
+        return false;
+
+    *pde = vtop(kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+    return true;
+}
+
+/** Project 3: THP - VPAGE가 아직 나뉘지 않은 2MB page 안에 있으면 true */
+bool pml4_is_large_page(uint64_t *pml4, const void *vpage) {
+    return large_pde(pml4, vpage) != NULL;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -237,15 +406,16 @@ void pml4_clear_page(uint64_t *pml4, void *upage) {
 
     if (pte != NULL && (*pte & PTE_P) != 0) {
         *pte &= ~PTE_P;
-        if (rcr3() == vtop(pml4))
-            invlpg((uint64_t)upage);
+        pml4_invalidate(pml4, upage);
     }
 }
 
 /* PML4의 가상 페이지 VPAGE에 대한 PTE가 더티인 경우, 즉 PTE가 설치된 이후 페이지가 수정된 경우 true를 반환합니다.
  * PML4에 VPAGE에 대한 PTE가 포함되어 있지 않으면 false를 반환합니다. */
 bool pml4_is_dirty(uint64_t *pml4, const void *vpage) {
-    uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+    uint64_t *pte = large_pde(pml4, vpage);  // 2MB page는 나누지 않고 PDE의 bit를 본다.
+    if (pte == NULL)
+        pte = pml4e_walk(pml4, (uint64_t)vpage, false);
     return pte != NULL && (*pte & PTE_D) != 0;
 }
 
@@ -258,28 +428,44 @@ void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty) {
         else
             *pte &= ~(uint32_t)PTE_D;
 
-        if (rcr3() == vtop(pml4))
-            invlpg((uint64_t)vpage);
+        pml4_invalidate(pml4, vpage);
+    }
+}
+
+/** Project 3: Copy On Write - VPAGE의 PTE에서 writable bit만 바꾼다.
+ * pml4_set_page와 달리 accessed/dirty bit는 그대로 둔다. */
+void pml4_set_writable(uint64_t *pml4, const void *vpage, bool writable) {
+    uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+    if (pte) {
+        if (writable)
+            *pte |= PTE_W;
+        else
+            *pte &= ~(uint64_t)PTE_W;
+
+        pml4_invalidate(pml4, vpage);
     }
 }
 
 /* PML4의 가상 페이지 VPAGE에 대한 PTE가 최근에, 즉 PTE가 설치된 시간과마지막으로 지워진 시간 사이에 액세스된 경우 true를 반환합니다.
  * PML4에 VPAGE에 대한 PTE가 포함되어 있지 않으면 false를 반환합니다. */
 bool pml4_is_accessed(uint64_t *pml4, const void *vpage) {
-    uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+    uint64_t *pte = large_pde(pml4, vpage);
+    if (pte == NULL)
+        pte = pml4e_walk(pml4, (uint64_t)vpage, false);
     return pte != NULL && (*pte & PTE_A) != 0;
 }
 
 /* PD의 가상 페이지 VPAGE에 대해 PTE에서 액세스된 비트를 ACCESSED로 설정합니다. */
 void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed) {
-    uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+    uint64_t *pte = large_pde(pml4, vpage);  // 2MB page는 2MB 단위로 accessed를 본다.
+    if (pte == NULL)
+        pte = pml4e_walk(pml4, (uint64_t)vpage, false);
     if (pte) {
         if (accessed)
             *pte |= PTE_A;
         else
             *pte &= ~(uint32_t)PTE_A;
 
-        if (rcr3() == vtop(pml4))
-            invlpg((uint64_t)vpage);
+        pml4_invalidate(pml4, vpage);
     }
 }
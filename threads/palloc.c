@@ -10,6 +10,7 @@
 #include <string.h>
 
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -33,6 +34,7 @@ struct pool {
     struct lock lock;        /* Mutual exclusion. */
     struct bitmap *used_map; /* Bitmap of free pages. */
     uint8_t *base;           /* Base of pool. */
+    size_t free_cnt;         /* Number of free pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -227,6 +229,9 @@ static void populate_pools(struct area *base_mem, struct area *ext_mem) {
             }
         }
     }
+
+    kernel_pool.free_cnt = bitmap_count(kernel_pool.used_map, 0, bitmap_size(kernel_pool.used_map), false);
+    user_pool.free_cnt = bitmap_count(user_pool.used_map, 0, bitmap_size(user_pool.used_map), false);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -256,6 +261,11 @@ void *palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
 
     lock_acquire(&pool->lock);
     size_t page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
+    if (page_idx != BITMAP_ERROR) {
+        enum intr_level old_level = intr_disable();
+        pool->free_cnt -= page_cnt;
+        intr_set_level(old_level);
+    }
     lock_release(&pool->lock);
     void *pages;
 
@@ -275,6 +285,35 @@ void *palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     return pages;
 }
 
+/** Project 3: THP - palloc_get_multiple과 같지만 첫 page의 주소가 ALIGN byte의 배수다.
+   Kernel 가상 주소와 물리 주소는 LOADER_KERN_BASE(2MB의 배수)만큼 차이 나므로
+   2MB 이하의 ALIGN이면 물리 주소도 같이 정렬된다. 실패하면 PAL_ASSERT와 관계없이 NULL. */
+void *palloc_get_multiple_aligned(enum palloc_flags flags, size_t page_cnt, size_t align) {
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    size_t step = align / PGSIZE;
+    size_t page_idx = (ROUND_UP((uint64_t)pool->base, align) - (uint64_t)pool->base) / PGSIZE;
+    void *pages = NULL;
+
+    ASSERT(align % PGSIZE == 0);
+
+    lock_acquire(&pool->lock);
+    for (; page_idx + page_cnt <= bitmap_size(pool->used_map); page_idx += step) {
+        if (bitmap_none(pool->used_map, page_idx, page_cnt)) {
+            bitmap_set_multiple(pool->used_map, page_idx, page_cnt, true);
+            enum intr_level old_level = intr_disable();
+            pool->free_cnt -= page_cnt;
+            intr_set_level(old_level);
+            pages = pool->base + PGSIZE * page_idx;
+            break;
+        }
+    }
+    lock_release(&pool->lock);
+
+    if (pages != NULL && (flags & PAL_ZERO))
+        memset(pages, 0, PGSIZE * page_cnt);
+    return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -309,6 +348,17 @@ void palloc_free_multiple(void *pages, size_t page_cnt) {
 #endif
     ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
     bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+
+    /* May be called with interrupts off (e.g. when a dying thread's
+       page is freed), so the count is updated without the pool lock. */
+    enum intr_level old_level = intr_disable();
+    pool->free_cnt += page_cnt;
+    intr_set_level(old_level);
+}
+
+/* Returns the number of free pages in the user pool. */
+size_t palloc_user_free_cnt(void) {
+    return user_pool.free_cnt;
 }
 
 /* Frees the page at PAGE. */
@@ -172,6 +172,7 @@ static void __do_fork(void *aux) {
     supplemental_page_table_init(&current->spt);
     if (!supplemental_page_table_copy(&current->spt, &parent->spt))
         goto error;
+    current->stack_bottom = parent->stack_bottom;  // stack page도 함께 복제됐다.
 #else
     if (!pml4_for_each(parent->pml4, duplicate_pte, parent))  // Page Table 통째로 복제
         goto error;
@@ -655,11 +656,9 @@ bool lazy_load_segment(struct page *page, void *aux) {
     /* TODO: Load the segment from the file */
     /* TODO: This called when the first page fault occurs on address VA. */
     /* TODO: VA is available when calling this function. */
-    file_seek(file, offset);                                                             // 파일을 offset부터 읽기
-    if (file_read(file, page->frame->kva, page_read_bytes) != (off_t)page_read_bytes) {  // 물리 메모리에서 정상적으로 읽어오는지 확인하고
-        palloc_free_page(page->frame->kva);                                              // 제대로 못 읽었다면 free시키고 false 리턴
-        return false;
-    }
+    /** Project 3: Copy On Write - fork한 process끼리 aux의 file을 같이 쓰므로 file 위치를 건드리지 않는다. */
+    if (file_read_at(file, page->frame->kva, page_read_bytes, offset) != (off_t)page_read_bytes)  // 물리 메모리에서 정상적으로 읽어오는지 확인하고
+        return false;  // 제대로 못 읽었다면 false 리턴. frame은 page가 destroy될 때 해제된다.
 
     memset(page->frame->kva + page_read_bytes, 0, page_zero_bytes);  // 남은 page의 데이터들은 0으로 초기화
 
@@ -685,31 +684,11 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage, uint32_t
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(ofs % PGSIZE == 0);
 
-    while (read_bytes > 0 || zero_bytes > 0) {
-        /* Do calculate how to fill this page.
-         * We will read PAGE_READ_BYTES bytes from FILE
-         * and zero the final PAGE_ZERO_BYTES bytes. */
-        size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-        size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-        /* TODO: Set up aux to pass information to the lazy_load_segment. */
-        /** Project 3: Anonymous Page - Container 생성  */
-        struct aux *aux = (struct aux *)malloc(sizeof(struct aux));
-        aux->file = file;
-        aux->offset = ofs;
-        aux->page_read_bytes = page_read_bytes;
-
-        /** Project 3: Anonymous Page - aux 대신 aux 삽입 */
-        if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable, lazy_load_segment, aux))
-            return false;
-
-        /* Advance. */
-        read_bytes -= page_read_bytes;
-        zero_bytes -= page_zero_bytes;
-        upage += PGSIZE;
-        ofs += page_read_bytes; /** Project 3: Anonymous Page - page_read_bytes 만큼 offset */
-    }
-    return true;
+    /** Project 3: Shared Text - read-only segment는 파일에서 다시 읽을 수 있으므로 file page로 두고 process끼리 frame을 공유한다.
+     *  Project 3: VMA - page마다 aux를 만들지 않고 segment 전체를 VMA 하나로 등록한다. Page는 처음 fault 날 때 만든다. */
+    enum vm_type type = writable ? VM_ANON : VM_FILE | VM_MARKER_1;
+    return vma_map(&thread_current()->spt, upage, upage + read_bytes + zero_bytes, type, writable, file, ofs, read_bytes,
+                   false) != NULL;
 }
 
 /** Project 3: Anonymous Page - Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -727,6 +706,7 @@ static bool setup_stack(struct intr_frame *if_) {
         if (success) {
             if_->rsp = USER_STACK;
             thread_current()->stack_bottom = stack_bottom;
+            vm_populate_stack(); /** Project 3: Populate */
         }
     }
 
@@ -1,5 +1,6 @@
 #include "userprog/syscall.h"
 
+#include <round.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 
@@ -114,11 +115,32 @@ void syscall_handler(struct intr_frame *f UNUSED) {
             break;
 #ifdef VM
         case SYS_MMAP:
-            f->R.rax = mmap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
+            f->R.rax = mmap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8, f->R.r9);
             break;
         case SYS_MUNMAP:
             munmap(f->R.rdi);
             break;
+        case SYS_MSYNC:
+            f->R.rax = msync((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+        case SYS_MADVISE:
+            f->R.rax = madvise((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+        case SYS_MINCORE:
+            f->R.rax = mincore((void *)f->R.rdi, f->R.rsi, (unsigned char *)f->R.rdx);
+            break;
+        case SYS_MLOCK:
+            f->R.rax = mlock((void *)f->R.rdi, f->R.rsi);
+            break;
+        case SYS_MUNLOCK:
+            f->R.rax = munlock((void *)f->R.rdi, f->R.rsi);
+            break;
+        case SYS_MLOCKALL:
+            f->R.rax = mlockall(f->R.rdi);
+            break;
+        case SYS_MUNLOCKALL:
+            f->R.rax = munlockall();
+            break;
 #endif
 #ifdef EFILESYS
         case SYS_ISDIR:
@@ -139,6 +161,15 @@ void syscall_handler(struct intr_frame *f UNUSED) {
         case SYS_SYMLINK:
             f->R.rax = symlink(f->R.rdi, f->R.rsi);
             break;
+        case SYS_MOUNT:
+            f->R.rax = mount(f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+        case SYS_UMOUNT:
+            f->R.rax = umount(f->R.rdi);
+            break;
+        case SYS_CLONE:
+            f->R.rax = clone(f->R.rdi, f->R.rsi);
+            break;
 #endif
         default:
             exit(-1);
@@ -164,13 +195,16 @@ struct page *check_address(void *addr) {
     return spt_find_page(&curr->spt, addr);
 }
 
-/** Project 3: Memory Mapped Files - 버퍼 유효성 검사 */
+/** Project 3: Memory Mapped Files - 버퍼 유효성 검사
+ *  Project 3: VMA - 아직 page가 만들어지지 않은 VMA 영역도 유효하다. byte 대신 page 단위로 검사한다. */
 void check_valid_buffer(void *buffer, size_t size, bool writable) {
-    for (size_t i = 0; i < size; i++) {
-        /* buffer가 spt에 존재하는지 검사 */
-        struct page *page = check_address(buffer + i);
+    if (size == 0)
+        return;
 
-        if (!page || (writable && !(page->writable)))
+    for (void *va = pg_round_down(buffer); va <= buffer + size - 1; va += PGSIZE) {
+        check_address(va);
+
+        if (!vm_check_access(va, writable))
             exit(-1);
     }
 }
@@ -404,7 +438,7 @@ int dup2(int oldfd, int newfd) {
 
 #ifdef VM
 /** Project 3: Memory Mapped Files - Memory Mapping */
-void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset, int flags) {
     if (!addr || pg_round_down(addr) != addr || is_kernel_vaddr(addr) || is_kernel_vaddr(addr + length))
         return NULL;
 
@@ -422,13 +456,74 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset) {
     if (file_length(file) == 0 || (long)length <= 0)
         return NULL;
 
-    return do_mmap(addr, length, writable, file, offset);
+    if (flags & ~MAP_POPULATE)
+        return NULL;
+
+    return do_mmap(addr, length, writable, file, offset, flags);
 }
 
 /** Project 3: Memory Mapped Files - Memory Unmapping */
 void munmap(void *addr) {
     do_munmap(addr);
 }
+
+/** Project 3: Clustered Writeback - Memory Sync */
+int msync(void *addr, size_t length, int flags) {
+    if (!addr || pg_round_down(addr) != addr || addr + length < addr || is_kernel_vaddr(addr) || is_kernel_vaddr(addr + length))
+        return -1;
+
+    if ((flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) || ((flags & MS_ASYNC) && (flags & MS_SYNC)))
+        return -1;
+
+    return do_msync(addr, length, flags);
+}
+
+/** Project 3: Madvise - Memory Advice */
+int madvise(void *addr, size_t length, int advice) {
+    if (!addr || pg_round_down(addr) != addr || addr + length < addr || is_kernel_vaddr(addr) || is_kernel_vaddr(addr + length))
+        return -1;
+
+    return vm_madvise(addr, length, advice);
+}
+
+/** Project 3: Madvise - Memory Residency */
+int mincore(void *addr, size_t length, unsigned char *vec) {
+    if (!addr || pg_round_down(addr) != addr || addr + length < addr || is_kernel_vaddr(addr) || is_kernel_vaddr(addr + length))
+        return -1;
+
+    check_valid_buffer(vec, DIV_ROUND_UP(length, PGSIZE), true);
+    return vm_mincore(addr, length, vec);
+}
+
+/** Project 3: Mlock - Lock Memory */
+int mlock(void *addr, size_t length) {
+    void *start = pg_round_down(addr);  // addr는 정렬되어 있지 않아도 된다.
+
+    if (!addr || addr + length < addr || is_kernel_vaddr(addr) || is_kernel_vaddr(addr + length))  // 끝이 넘쳐 돌아가는 범위도 막는다.
+        return -1;
+
+    return vm_mlock(start, addr + length - start);
+}
+
+/** Project 3: Mlock - Unlock Memory */
+int munlock(void *addr, size_t length) {
+    void *start = pg_round_down(addr);
+
+    if (!addr || addr + length < addr || is_kernel_vaddr(addr) || is_kernel_vaddr(addr + length))
+        return -1;
+
+    return vm_munlock(start, addr + length - start);
+}
+
+/** Project 3: Mlock - Lock All Memory */
+int mlockall(int flags) {
+    return vm_mlockall(flags);
+}
+
+/** Project 3: Mlock - Unlock All Memory */
+int munlockall(void) {
+    return vm_munlockall();
+}
 #endif
 
 #ifdef EFILESYS
@@ -439,7 +534,11 @@ bool chdir(const char *dir) {
 
 /** #Project 4: File System - Creates the directory named dir, which may be relative or absolute. */
 bool mkdir(const char *dir) {
-    return filesys_mkdir(dir);
+    lock_acquire(&filesys_lock);  // defragd와 cluster 할당이 겹치지 않도록
+    bool success = filesys_mkdir(dir);
+    lock_release(&filesys_lock);
+
+    return success;
 }
 
 /** #Project 4: File System - Reads a directory entry from file descriptor fd, which must represent a directory. */
@@ -476,6 +575,44 @@ int symlink(const char *target, const char *linkpath) {
     check_address(target);
     check_address(linkpath);
 
-    return filesys_symlink(target, linkpath) ? 0 : -1;
+    lock_acquire(&filesys_lock);  // defragd와 cluster 할당이 겹치지 않도록
+    bool success = filesys_symlink(target, linkpath);
+    lock_release(&filesys_lock);
+
+    return success ? 0 : -1;
+}
+
+/** Project 4: Mount - Mounts the disk CHAN_NO:DEV_NO on the directory PATH. */
+int mount(const char *path, int chan_no, int dev_no) {
+    check_address(path);
+
+    lock_acquire(&filesys_lock);
+    int result = filesys_mount(path, chan_no, dev_no);
+    lock_release(&filesys_lock);
+
+    return result;
+}
+
+/** Project 4: Mount - Unmounts the volume mounted on PATH. */
+int umount(const char *path) {
+    check_address(path);
+
+    lock_acquire(&filesys_lock);
+    int result = filesys_umount(path);
+    lock_release(&filesys_lock);
+
+    return result;
+}
+
+/** Project 4: Clone - DST를 SRC와 cluster를 공유하는 새 file로 만든다. */
+int clone(const char *src, const char *dst) {
+    check_address(src);
+    check_address(dst);
+
+    lock_acquire(&filesys_lock);
+    int result = filesys_clone(src, dst);
+    lock_release(&filesys_lock);
+
+    return result;
 }
 #endif
@@ -2,10 +2,14 @@
 
 #include <bitmap.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "devices/disk.h"
+#include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "threads/synch.h"
 #include "vm/vm.h"
+#include "vm/zswap.h"
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
 static bool anon_swap_in(struct page *page, void *kva);
@@ -22,6 +26,22 @@ static const struct page_operations anon_ops = {
 
 struct bitmap *swap_table;
 size_t slot_max;
+/** Project 3: Reverse Map - slot을 가리키는 anon page 수. 공유 frame을 swap out하면 여럿이 된다. */
+static uint16_t *slot_cnt;
+/** Project 3: Copy On Write - swap_table과 slot_cnt 보호. frame_lock 다음에 잡는다. */
+static struct lock swap_lock;
+/** Project 3: Swap Cluster - 여러 page를 인접한 slot에 한 번에 쓰기 위한 buffer. frame_lock이 보호 */
+static uint8_t *cluster_buf;
+/** Project 3: Swap Cluster - 새 run을 찾기 시작할 slot (next-fit) */
+static size_t swap_hint;
+
+/** Project 3: Swap Read-ahead - swap in 할 때 뒤따르는 slot을 미리 읽어 두는 swap cache.
+ * ra_buf[i]에는 slot ra_first + i의 내용이 있고, ra_valid[i]가 false면 쓸 수 없다. */
+static uint8_t *ra_buf;
+static size_t ra_first = BITMAP_ERROR;
+static size_t ra_cnt;
+static bool ra_valid[SWAP_READAHEAD];
+static struct lock ra_lock; /* swap cache 보호. frame_lock 다음, swap_lock 전에 잡는다. */
 
 /* Initialize the data for anonymous pages */
 void vm_anon_init(void) {
@@ -29,6 +49,86 @@ void vm_anon_init(void) {
     swap_disk = disk_get(1, 1);
     slot_max = disk_size(swap_disk) / SLOT_SIZE;
     swap_table = bitmap_create(slot_max);
+    slot_cnt = calloc(slot_max, sizeof *slot_cnt);
+    lock_init(&swap_lock);
+    cluster_buf = palloc_get_multiple(PAL_ASSERT, SWAP_CLUSTER);
+    lock_init(&ra_lock);
+    ra_buf = palloc_get_multiple(PAL_ASSERT, SWAP_READAHEAD);
+    zswap_init(slot_max);
+}
+
+/* Swap cache에서 SLOT을 지운다. SLOT의 내용이 바뀌거나 비워진 뒤에 호출 */
+static void swap_cache_invalidate(size_t slot) {
+    lock_acquire(&ra_lock);
+    if (ra_first != BITMAP_ERROR && slot >= ra_first && slot < ra_first + ra_cnt)
+        ra_valid[slot - ra_first] = false;
+    lock_release(&ra_lock);
+}
+
+/* SLOT의 참조를 하나 줄이고 아무도 안 쓰면 비운다. */
+static void anon_slot_put(size_t slot) {
+    bool freed;
+
+    lock_acquire(&swap_lock);
+    freed = --slot_cnt[slot] == 0;
+    lock_release(&swap_lock);
+
+    if (!freed)
+        return;
+
+    /* 압축본을 먼저 버린다. Bitmap이 켜져 있는 동안에는 zswapd가 쓰고 있는 slot이 재사용되지 않는다. */
+    zswap_invalidate(slot);
+    lock_acquire(&swap_lock);
+    bitmap_reset(swap_table, slot);
+    lock_release(&swap_lock);
+    swap_cache_invalidate(slot);
+}
+
+/** Project 3: Zswap - zswapd가 압축 tier에서 내리는 PAGE를 SLOT의 disk 자리에 쓴다. */
+void anon_swap_write(size_t slot, const void *page) {
+    disk_write_multi(swap_disk, slot * SLOT_SIZE, page, SLOT_SIZE);
+    swap_cache_invalidate(slot);  // read-ahead가 예전 disk 내용을 읽어 두었을 수 있다.
+}
+
+/** Project 3: Swap Cluster - SPT의 process에 인접한 slot CNT개를 할당한다.
+ * 지난번에 쓴 slot 바로 뒤가 비어 있으면 이어서 쓰고, 아니면 SWAP_CLUSTER개짜리 빈 run을
+ * swap_hint부터 next-fit으로 찾아 그 process의 다음 swap out들이 이어지도록 한다. */
+static size_t anon_slot_alloc(struct supplemental_page_table *spt, size_t cnt) {
+    size_t run = cnt > SWAP_CLUSTER ? cnt : SWAP_CLUSTER;
+    size_t first = spt->swap_cursor;
+
+    lock_acquire(&swap_lock);
+    if (first == BITMAP_ERROR || first + cnt > slot_max || !bitmap_none(swap_table, first, cnt)) {
+        first = bitmap_scan(swap_table, swap_hint, run, false);
+        if (first == BITMAP_ERROR)
+            first = bitmap_scan(swap_table, 0, run, false);
+        if (first == BITMAP_ERROR)  // 큰 run이 없으면 아무 곳이나
+            first = bitmap_scan(swap_table, 0, cnt, false);
+        if (first != BITMAP_ERROR)
+            swap_hint = first + run < slot_max ? first + run : 0;
+    }
+
+    if (first != BITMAP_ERROR) {
+        bitmap_set_multiple(swap_table, first, cnt, true);
+        spt->swap_cursor = first + cnt;
+    }
+    lock_release(&swap_lock);
+
+    return first;
+}
+
+/** Project 3: Copy On Write - fork 때 swap out되어 있는 SRC의 slot을 DST도 가리키게 한다.
+ * 먼저 swap in 하는 쪽이 읽어가고, 마지막으로 읽는 쪽이 slot을 비운다. */
+void anon_share_slot(struct page *dst, struct page *src) {
+    size_t slot = src->anon.slot;
+
+    dst->anon.slot = slot;
+    if (slot == BITMAP_ERROR)
+        return;
+
+    lock_acquire(&swap_lock);
+    slot_cnt[slot]++;
+    lock_release(&swap_lock);
 }
 
 /** Project 3: Anonymous Page - Initialize the file mapping */
@@ -56,35 +156,156 @@ static bool anon_swap_in(struct page *page, void *kva) {
     if (slot == BITMAP_ERROR || !bitmap_test(swap_table, slot))
         return false;
 
-    bitmap_set(swap_table, slot, false);
+    /** Project 3: Zswap - 압축 tier에 있으면 disk를 읽지 않고 푼다.
+     * 압축본이 깨졌으면 틀린 내용을 넘기지 않고 fault를 실패시켜 process를 끝낸다. */
+    switch (zswap_load(slot, kva)) {
+        case ZSWAP_HIT:
+            return true;
+        case ZSWAP_CORRUPT:
+            return false;
+        case ZSWAP_MISS:
+            break;
+    }
+
+    lock_acquire(&ra_lock);
+    if (ra_first != BITMAP_ERROR && slot >= ra_first && slot < ra_first + ra_cnt && ra_valid[slot - ra_first]) {
+        memcpy(kva, ra_buf + PGSIZE * (slot - ra_first), PGSIZE);  // 미리 읽어 둔 slot
+        ra_valid[slot - ra_first] = false;
+    } else {
+        /** Project 3: Swap Read-ahead - 뒤따르는 사용 중인 slot들을 같은 disk command로 함께 읽는다.
+         * 같은 process의 page는 인접한 slot에 있으므로 곧 이어서 fault 날 가능성이 높다. */
+        size_t cnt = 1;
+
+        lock_acquire(&swap_lock);
+        while (cnt < SWAP_READAHEAD && slot + cnt < slot_max && bitmap_test(swap_table, slot + cnt))
+            cnt++;
+        lock_release(&swap_lock);
 
-    for (size_t i = 0; i < SLOT_SIZE; i++)
-        disk_read(swap_disk, sector + i, kva + DISK_SECTOR_SIZE * i);
+        if (cnt == 1)
+            disk_read_multi(swap_disk, sector, kva, SLOT_SIZE);  // page 하나를 disk command 한 번으로 읽는다.
+        else {
+            disk_read_multi(swap_disk, sector, ra_buf, cnt * SLOT_SIZE);
+            memcpy(kva, ra_buf, PGSIZE);
 
-    sector = BITMAP_ERROR;
+            ra_first = slot;
+            ra_cnt = cnt;
+            ra_valid[0] = false;
+            for (size_t i = 1; i < cnt; i++)
+                ra_valid[i] = true;
+        }
+    }
+    lock_release(&ra_lock);
 
+    /** Project 3: Swap Cache - slot은 page가 dirty 해질 때까지 그대로 둔다.
+     * 바뀌지 않은 채로 다시 evict 되면 disk에 쓰지 않고 frame만 떼어낸다. */
     return true;
 }
 
+/* FRAME을 매핑하던 page들이 모두 SLOT을 가리키게 하고 frame에서 떼어낸다. */
+static void anon_frame_swapped(struct frame *frame, size_t slot) {
+    /** Project 3: Reverse Map - frame을 공유하던 page들이 모두 같은 slot을 가리킨다. */
+    struct list_elem *e;
+    for (e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e))
+        list_entry(e, struct page, rmap_elem)->anon.slot = slot;
+    slot_cnt[slot] = frame->cnt;
+
+    vm_frame_unmap_all(frame);
+}
+
+/** Project 3: Swap Cache - FRAME의 내용이 swap slot과 같으면 true.
+ * 모든 mapping이 같은 slot을 가리키고 어느 PTE도 dirty가 아니어야 한다.
+ * 아니면 예전 slot은 더 이상 맞지 않으므로 놓아준다. frame_lock을 잡은 상태로 호출 */
+static bool anon_frame_clean(struct frame *frame) {
+    size_t slot = frame->page->anon.slot;
+    bool clean = slot != BITMAP_ERROR && !vm_frame_dirty(frame);
+    struct list_elem *e;
+
+    for (e = list_begin(&frame->rmap); e != list_end(&frame->rmap) && clean; e = list_next(e))
+        clean = list_entry(e, struct page, rmap_elem)->anon.slot == slot;
+    if (clean)
+        return true;
+
+    for (e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e)) {
+        struct anon_page *anon_page = &list_entry(e, struct page, rmap_elem)->anon;
+        if (anon_page->slot != BITMAP_ERROR) {
+            anon_slot_put(anon_page->slot);
+            anon_page->slot = BITMAP_ERROR;
+        }
+    }
+    return false;
+}
+
 /** Project 3: Swap In/Out - Swap out the page by writing contents to the swap disk. */
 static bool anon_swap_out(struct page *page) {
-    struct anon_page *anon_page = &page->anon;
+    /** Project 3: Swap Cache - swap에서 읽은 뒤 바뀌지 않았으면 쓰지 않는다. page들은 slot을 그대로 가리킨다. */
+    if (anon_frame_clean(page->frame)) {
+        vm_frame_unmap_all(page->frame);
+        return true;
+    }
 
-    size_t free_idx = bitmap_scan_and_flip(swap_table, 0, 1, false);
+    size_t free_idx = anon_slot_alloc(page->spt, 1);
 
     if (free_idx == BITMAP_ERROR)
         return false;
 
-    size_t sector = free_idx * SLOT_SIZE;
+    /** Project 3: Clock - 다른 process의 page일 수 있으므로 va 대신 kva를 쓴다. */
+    struct frame *frame = page->frame;
+    if (!zswap_store(free_idx, frame->kva))  // 압축되지 않거나 tier가 가득 차면 disk로
+        disk_write_multi(swap_disk, free_idx * SLOT_SIZE, frame->kva, SLOT_SIZE);
+    swap_cache_invalidate(free_idx);
+
+    anon_frame_swapped(frame, free_idx);
 
-    for (size_t i = 0; i < SLOT_SIZE; i++)
-        disk_write(swap_disk, sector + i, page->va + DISK_SECTOR_SIZE * i);
+    return true;
+}
+
+/** Project 3: Swap Cluster - anon page가 올라간 FRAMES CNT개를 인접한 slot에 disk write 한 번으로 swap out 한다.
+ * Swap cache에 있는 clean frame은 쓰지 않고 바로 떼어낸다.
+ * 나머지를 위한 인접한 빈 slot이 없으면 false. frame_lock을 잡은 상태로 호출 */
+bool anon_swap_out_cluster(struct frame **frames, size_t cnt) {
+    struct frame *order[SWAP_CLUSTER];
+    bool stored[SWAP_CLUSTER];
+    struct supplemental_page_table *spt = frames[0]->page->spt;
+    size_t i, j, dirty = 0;
+
+    ASSERT(cnt > 0 && cnt <= SWAP_CLUSTER);
+
+    /* 주소 순서로 slot에 놓아야 swap in 할 때 read-ahead가 맞는다. */
+    for (i = 0; i < cnt; i++) {
+        if (anon_frame_clean(frames[i])) {
+            vm_frame_unmap_all(frames[i]);
+            continue;
+        }
+        for (j = dirty; j > 0 && frames[i]->page->va < order[j - 1]->page->va; j--)
+            order[j] = order[j - 1];
+        order[j] = frames[i];
+        dirty++;
+    }
+    cnt = dirty;
+    if (cnt == 0)
+        return true;
 
-    anon_page->slot = free_idx;
+    size_t first = anon_slot_alloc(spt, cnt);
+    if (first == BITMAP_ERROR)
+        return false;
+
+    /** Project 3: Zswap - 압축 tier에 들어가지 못한 page들만 연속된 run 단위로 disk에 쓴다. */
+    for (i = 0; i < cnt; i++) {
+        stored[i] = zswap_store(first + i, order[i]->kva);
+        if (!stored[i])
+            memcpy(cluster_buf + PGSIZE * i, order[i]->kva, PGSIZE);
+    }
+    for (i = 0; i < cnt; i = j + 1) {
+        for (j = i; j < cnt && !stored[j]; j++)
+            ;
+        if (j > i)
+            disk_write_multi(swap_disk, (first + i) * SLOT_SIZE, cluster_buf + PGSIZE * i, (j - i) * SLOT_SIZE);
+    }
 
-    page->frame->page = NULL;
-    page->frame = NULL;
-    pml4_clear_page(thread_current()->pml4, page->va);
+    for (i = 0; i < cnt; i++) {
+        swap_cache_invalidate(first + i);
+        anon_frame_swapped(order[i], first + i);
+    }
 
     return true;
 }
@@ -95,17 +316,9 @@ static void anon_destroy(struct page *page) {
 
     /** Project 3: Swap In/Out - 점거중인 bitmap 삭제 */
     if (anon_page->slot != BITMAP_ERROR)
-        bitmap_reset(swap_table, anon_page->slot);
-
-    /** Project 3: Anonymous Page - 점거중인 frame 삭제 */
-    if (page->frame) {
-        list_remove(&page->frame->frame_elem);
-        page->frame->page = NULL;
-        free(page->frame);
-        page->frame = NULL;
-    }
+        anon_slot_put(anon_page->slot);
 
-    /** Project 3: Copy on Write (Extra) - destroy 시 pml4 clear하여 참조하던 kva들을 모두 해제한다.
-     * 그렇지 않으면 자식에서 `exit`시 참조한 부모의 kva가 파괴되어 자식이 부모에서 해당 kva에 접근할 수 없기 때문이다. */
-    pml4_clear_page(thread_current()->pml4, page->va);
+    /** Project 3: Reverse Map - mapping을 지우고, 마지막 mapping이었으면 frame도 해제된다.
+     * 공유 중인 frame은 다른 process가 계속 쓰므로 해제되지 않는다. */
+    vm_frame_unmap(page);
 }
@@ -2,6 +2,9 @@
 
 #include "vm/vm.h"
 
+#include <round.h>
+#include <string.h>
+
 /** Project 3: Memory Mapped Files */
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -36,6 +39,7 @@ bool file_backed_initializer(struct page *page, enum vm_type type, void *kva) {
     file_page->file = aux->file;
     file_page->offset = aux->offset;
     file_page->page_read_bytes = aux->page_read_bytes;
+    file_page->text = (type & VM_MARKER_1) != 0;
 
     return true;
 }
@@ -50,14 +54,13 @@ static bool file_backed_swap_in(struct page *page, void *kva) {
 /** Project 3: Swap In/Out - Swap out the page by writeback contents to the file. */
 static bool file_backed_swap_out(struct page *page) {
     struct file_page *file_page UNUSED = &page->file;
-    if (pml4_is_dirty(thread_current()->pml4, page->va)) {
-        file_write_at(file_page->file, page->va, file_page->page_read_bytes, file_page->offset);
-        pml4_set_dirty(thread_current()->pml4, page->va, false);
-    }
+    /** Project 3: Clock - 다른 process의 page일 수 있으므로 va 대신 kva를 쓴다. */
+    struct frame *frame = page->frame;
+
+    if (vm_frame_dirty(frame))  // fork로 공유 중이면 어느 mapping에서든 쓸 수 있다.
+        file_write_at(file_page->file, frame->kva, file_page->page_read_bytes, file_page->offset);
 
-    page->frame->page = NULL;
-    page->frame = NULL;
-    pml4_clear_page(thread_current()->pml4, page->va);
+    vm_frame_unmap_all(frame);
 
     return true;
 }
@@ -66,76 +69,151 @@ static bool file_backed_swap_out(struct page *page) {
 static void file_backed_destroy(struct page *page) {
     struct file_page *file_page UNUSED = &page->file;
 
-    if (pml4_is_dirty(thread_current()->pml4, page->va)) {
-        file_write_at(file_page->file, page->va, file_page->page_read_bytes, file_page->offset);
-        pml4_set_dirty(thread_current()->pml4, page->va, false);
-    }
-
-    if (page->frame) {
-        list_remove(&page->frame->frame_elem);
-        page->frame->page = NULL;
-        page->frame = NULL;
-        free(page->frame);
+    /* 이미 munmap 되었거나 evict된 page는 frame이 없다. */
+    if (page->frame != NULL && pml4_is_dirty(page->pml4, page->va)) {
+        file_write_at(file_page->file, page->frame->kva, file_page->page_read_bytes, file_page->offset);
+        pml4_set_dirty(page->pml4, page->va, false);
     }
 
-    pml4_clear_page(thread_current()->pml4, page->va);
+    /** Project 3: Reverse Map */
+    vm_frame_unmap(page);
 }
 
-/** Project 3: Memory Mapped Files - Memory Mapping - Do the mmap */
-void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t offset) {
-    lock_acquire(&filesys_lock);
-    struct file *mfile = file_reopen(file);
-    void *ori_addr = addr;
-    size_t read_bytes = (length > file_length(mfile)) ? file_length(mfile) : length;
-    size_t zero_bytes = PGSIZE - read_bytes % PGSIZE;
+/* 한 번의 file_write_at으로 모아서 쓸 최대 page 수 */
+#define WRITEBACK_PAGES 16
 
-    ASSERT((read_bytes + zero_bytes) % PGSIZE == 0);
-    ASSERT(pg_ofs(addr) == 0);
-    ASSERT(offset % PGSIZE == 0);
+/* RUN에 모인 CNT개의 page를 BUF(없으면 첫 page의 frame)에서 파일의 OFS부터 LEN byte 쓰고 pin을 푼다. */
+static void writeback_flush(struct page **run, size_t cnt, uint8_t *buf, off_t ofs, size_t len) {
+    if (cnt == 0)
+        return;
 
-    struct aux *aux;
-    while (read_bytes > 0 || zero_bytes > 0) {
-        size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-        size_t page_zero_bytes = PGSIZE - page_read_bytes;
+    file_write_at(run[0]->file.file, buf != NULL ? buf : run[0]->frame->kva, len, ofs);
+    for (size_t i = 0; i < cnt; i++)
+        run[i]->frame->pinned = false;
+}
 
-        aux = (struct aux *)malloc(sizeof(struct aux));
-        if (!aux)
-            goto err;
+/** Project 3: Clustered Writeback - VMA의 [START, END)에서 dirty page를 주소 순서대로 모아
+ * 파일 위치가 이어지는 page들은 file_write_at 한 번으로 쓴다. 모을 buffer가 없으면 page마다 쓴다. */
+void file_writeback(struct vma *vma, void *start, void *end) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    uint8_t *buf = palloc_get_multiple(0, WRITEBACK_PAGES);
+    size_t max = buf != NULL ? WRITEBACK_PAGES : 1;
+    struct page *run[WRITEBACK_PAGES];
+    size_t cnt = 0, len = 0;
+    off_t ofs = 0;
 
-        aux->file = mfile;
-        aux->offset = offset;
-        aux->page_read_bytes = page_read_bytes;
+    ASSERT(vma->start <= start && end <= vma->end);
 
-        if (!vm_alloc_page_with_initializer(VM_FILE, addr, writable, lazy_load_segment, aux)) {
-            goto err;
+    lock_acquire(&filesys_lock);
+    for (void *va = start; va < end; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+
+        if (page == NULL || VM_TYPE(page->operations->type) != VM_FILE || page->file.page_read_bytes == 0 ||
+            !vm_frame_pin_dirty(page)) {
+            writeback_flush(run, cnt, buf, ofs, len);
+            cnt = len = 0;
+            continue;
+        }
+
+        if (cnt == max || (cnt > 0 && page->file.offset != ofs + (off_t)len)) {
+            writeback_flush(run, cnt, buf, ofs, len);
+            cnt = len = 0;
         }
 
-        read_bytes -= page_read_bytes;
-        zero_bytes -= page_zero_bytes;
-        addr += PGSIZE;
-        offset += page_read_bytes;
+        if (cnt == 0)
+            ofs = page->file.offset;
+        if (buf != NULL)
+            memcpy(buf + len, page->frame->kva, page->file.page_read_bytes);
+        len += page->file.page_read_bytes;
+        run[cnt++] = page;
+
+        if (page->file.page_read_bytes < PGSIZE) {  // 파일의 끝. 다음 page와 이어지지 않는다.
+            writeback_flush(run, cnt, buf, ofs, len);
+            cnt = len = 0;
+        }
     }
+    writeback_flush(run, cnt, buf, ofs, len);
     lock_release(&filesys_lock);
 
-    return ori_addr;
+    if (buf != NULL)
+        palloc_free_multiple(buf, WRITEBACK_PAGES);
+}
+
+/** Project 3: Memory Mapped Files - Memory Mapping - Do the mmap
+ *  Project 3: VMA - 영역을 VMA 하나로 등록만 하고 page는 처음 접근할 때 만든다.
+ *  Project 3: Populate - MAP_POPULATE면 지금 모두 읽어 매핑한다. 채우지 못한 page는 그대로 fault 때 채운다. */
+void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t offset, int flags) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    void *end = addr + ROUND_UP(length, PGSIZE);
+    struct vma *vma;
+
+    ASSERT(pg_ofs(addr) == 0);
+    ASSERT(offset % PGSIZE == 0);
+
+    /* VMA끼리 겹치는 것은 vma_map이 막는다. VMA 없이 만드는 page는 stack뿐이므로 범위만 비교한다. */
+    if (addr < (void *)USER_STACK && end > thread_current()->stack_bottom)
+        return NULL;
+
+    lock_acquire(&filesys_lock);
+    off_t flen = file_length(file);
+    size_t read_bytes = offset >= flen ? 0 : (size_t)(flen - offset);
+    if (read_bytes > length)
+        read_bytes = length;
 
-err:
-    free(aux);
+    vma = vma_map(spt, addr, end, VM_FILE, writable, file, offset, read_bytes, true);
     lock_release(&filesys_lock);
-    return NULL;
+
+    if (vma != NULL && (flags & MAP_POPULATE))
+        vm_populate(vma, vma->start, vma->end);
+
+    return vma != NULL ? addr : NULL;
 }
 
 /** Project 3: Memory Mapped Files - Memory Mapping - Do the munmap */
 void do_munmap(void *addr) {
-    struct thread *curr = thread_current();
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    struct vma *vma = vma_find(spt, addr);
     struct page *page;
 
+    if (vma == NULL || vma->start != addr || !vma->mmap)
+        return;
+
+    if (vma->writable)  // 먼저 모아서 써 두면 destroy에서는 쓸 page가 없다.
+        file_writeback(vma, vma->start, vma->end);
+
     lock_acquire(&filesys_lock);
-    while ((page = spt_find_page(&curr->spt, addr))) {
-        if (page)
-            destroy(page);
+    for (void *va = vma->start; va < vma->end; va += PGSIZE)
+        if ((page = spt_find_page(spt, va)))
+            spt_remove_page(spt, page);  // dirty page는 destroy에서 파일에 쓴다.
 
-        addr += PGSIZE;
-    }
+    vma_unmap(spt, vma);
     lock_release(&filesys_lock);
 }
+
+/** Project 3: Clustered Writeback - [ADDR, ADDR + LENGTH)의 dirty mmap page를 파일에 쓴다.
+ * MS_ASYNC는 evict, munmap, exit 때 어차피 쓰이므로 아무것도 하지 않는다. 범위에 mapping되지 않은 곳이 있으면 -1 */
+int do_msync(void *addr, size_t length, int flags) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    void *end = addr + ROUND_UP(length, PGSIZE);
+    void *va;
+
+    for (va = addr; va < end;) {  // 쓰기 전에 전체 범위부터 확인한다.
+        struct vma *vma = vma_find(spt, va);
+        if (vma == NULL || !vma->mmap)
+            return -1;
+        va = vma->end;
+    }
+
+    if (!(flags & MS_SYNC))
+        return 0;
+
+    for (va = addr; va < end;) {
+        struct vma *vma = vma_find(spt, va);
+        void *stop = vma->end < end ? vma->end : end;
+
+        if (vma->writable)
+            file_writeback(vma, va, stop);
+        va = stop;
+    }
+    return 0;
+}
@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 /** 반드시 vm.h 밑에 있어야 Compile Error가 사라짐 */
+#include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "vm/uninit.h"
 
@@ -59,5 +60,7 @@ static void uninit_destroy(struct page *page) {
     struct uninit_page *uninit UNUSED = &page->uninit;
     /* TODO: Fill this function.
      * TODO: If you don't have anything to do, just return. */
+    /** Project 3: Zero Page - zero page가 매핑되어 있을 수 있다. pml4_destroy가 해제하지 않도록 지운다. */
+    pml4_clear_page(page->pml4, page->va);
     return;
 }
@@ -1,13 +1,71 @@
 /* vm.c: Generic interface for virtual memory objects. */
 #include "vm/vm.h"
 
+#include <bitmap.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "userprog/process.h"
+#include "userprog/syscall.h"
 #include "vm/inspect.h"
 
 static struct list frame_table;
+static struct lock frame_lock;         /** Project 3: Clock - frame_table과 clock_hand 보호 */
+static struct list_elem *clock_hand;  /** Project 3: Clock - 다음에 검사할 frame. NULL이면 처음부터 */
+static void *zero_page;               /** Project 3: Zero Page - 모든 process가 read-only로 같이 매핑하는 빈 page */
+
+/** Project 3: Swap Cluster - 함께 swap out할 frame을 찾을 때 검사하는 최대 frame 수 */
+#define SWAP_CLUSTER_SCAN (SWAP_CLUSTER * 4)
+
+/** Project 3: Kswapd - user pool 크기 대비 watermark (%) */
+#define KSWAPD_LOW_PCT 2
+#define KSWAPD_HIGH_PCT 4
+
+static size_t kswapd_low, kswapd_high; /* 빈 page 수 기준 watermark */
+
+/** Project 3: Mlock - 모든 process를 합쳐 mlock 된 frame이 user pool에서 차지할 수 있는 최대 비율 (%) */
+#define MLOCK_FRAME_PCT 50
+
+static size_t locked_frames;      /* locked > 0인 frame 수. frame_lock이 보호한다. */
+static size_t locked_frame_limit; /* locked_frames의 상한 */
+static struct semaphore kswapd_sema;
+static bool kswapd_awake;
+static void kswapd(void *aux);
+
+/** Project 3: KSM - 내용이 같은 anon frame을 찾아 하나의 read-only COW frame으로 합친다.
+ * 두 번 연속 scan에서 hash가 같았던(자주 안 바뀌는) frame만 ksm_table에 들어간다. */
+#define KSM_BUCKETS 256
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+
+size_t ksm_scan_pages = KSM_SCAN_PAGES; /* KSM_INTERVAL마다 검사할 frame 수. 0이면 ksmd를 띄우지 않는다. */
+static struct list ksm_table[KSM_BUCKETS];
+static struct list_elem *ksm_cursor; /* 다음에 검사할 frame */
+static size_t ksm_shared;            /* 다른 frame이 합쳐진 frame 수 */
+static size_t ksm_saved;             /* 합쳐져서 돌려준 frame 수 */
+static void ksmd(void *aux);
+
+/** Project 3: Shared Text - 실행 파일의 read-only page를 (inode, offset)으로 찾는 table. frame_lock이 보호한다.
+ * 실행 중인 파일은 write가 막혀 있으므로 mapping이 하나라도 남아 있는 동안 내용이 바뀌지 않는다. */
+#define TEXT_BUCKETS 64
+static struct list text_table[TEXT_BUCKETS];
+
+/** Project 3: THP - 2MB page 하나에 들어가는 4KB page 수 */
+#define THP_PAGES (LARGE_PGSIZE / PGSIZE)
+
+/** Project 3: Fault Around - fault 한 번에 함께 채우는 정렬된 범위 (page 수) */
+#define FAULT_AROUND_PAGES 16
+/** Project 3: Madvise - MADV_SEQUENTIAL인 VMA에서 fault 뒤로 미리 읽는 page 수 */
+#define SEQ_READAHEAD_PAGES (FAULT_AROUND_PAGES * 2)
+
+/** Project 3: Populate - 미리 채울 때 파일에서 한 번에 읽는 page 수 */
+#define POPULATE_PAGES 16
+size_t stack_prefault_pages; /* process 시작 때 미리 매핑할 stack page 수. -stack=N으로 바꾼다. */
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -21,6 +79,34 @@ void vm_init(void) {
     /* DO NOT MODIFY UPPER LINES. */
     /* TODO: Your code goes here. */
     list_init(&frame_table);
+    lock_init(&frame_lock);
+    clock_hand = NULL;
+    zero_page = palloc_get_page(PAL_ASSERT | PAL_ZERO);  // user pool을 쓰지 않도록 kernel pool에서
+
+    /** Project 3: Kswapd - 지금 비어 있는 user page 수로 watermark를 정한다. */
+    size_t user_pages = palloc_user_free_cnt();
+    kswapd_low = user_pages * KSWAPD_LOW_PCT / 100;
+    if (kswapd_low < SWAP_CLUSTER)
+        kswapd_low = SWAP_CLUSTER;
+    if (kswapd_low > user_pages / 8)  // 작은 user pool에서 너무 많이 비우지 않도록
+        kswapd_low = user_pages / 8;
+    kswapd_high = user_pages * KSWAPD_HIGH_PCT / 100;
+    if (kswapd_high < kswapd_low * 2)
+        kswapd_high = kswapd_low * 2;
+    sema_init(&kswapd_sema, 0);
+    thread_create("kswapd", PRI_DEFAULT, kswapd, NULL);
+
+    /** Project 3: Mlock - evict 할 frame이 남도록 전체 mlock 양을 제한한다. */
+    locked_frames = 0;
+    locked_frame_limit = user_pages * MLOCK_FRAME_PCT / 100;
+
+    for (size_t i = 0; i < KSM_BUCKETS; i++)
+        list_init(&ksm_table[i]);
+    for (size_t i = 0; i < TEXT_BUCKETS; i++)
+        list_init(&text_table[i]);
+    ksm_cursor = NULL;
+    if (ksm_scan_pages > 0)
+        thread_create("ksmd", PRI_MIN, ksmd, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -39,6 +125,7 @@ enum vm_type page_get_type(struct page *page) {
 /* Helpers */
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
+static bool vm_lock_page(struct page *page);
 static struct frame *vm_evict_frame(void);
 
 /** Project 3: Anonymous Page - 이니셜라이저를 사용하여 보류 중인 페이지 개체를 만듭니다.
@@ -70,6 +157,8 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
         uninit_new(page, upage, init, type, aux, initializer);
 
         page->writable = writable;
+        page->pml4 = thread_current()->pml4;
+        page->spt = spt;
 
         /* TODO: Insert the page into the spt. */
         return spt_insert_page(spt, page);
@@ -81,10 +170,9 @@ err:
 /** Project 3: Memory Management - spt에서 va를 찾아 페이지를 리턴합니다. 오류가 발생하면 NULL을 반환합니다. */
 struct page *spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
     /* TODO: Fill this function. */
-    struct page *page = (struct page *)malloc(sizeof(struct page));     // 가상 주소에 대응하는 해시 값 도출을 위해 새로운 페이지 할당
-    page->va = pg_round_down(va);                                       // 가상 주소의 시작 주소를 페이지의 va에 복제
-    struct hash_elem *e = hash_find(&spt->spt_hash, &page->hash_elem);  // spt hash 테이블에서 hash_elem과 같은 hash를 갖는 페이지를 찾아서 return
-    free(page);                                                         // 복제한 페이지 삭제
+    struct page key;                                                  /** Project 3: VMA - hash key로만 쓰므로 할당하지 않고 stack에 둔다. */
+    key.va = pg_round_down(va);                                       // 가상 주소의 시작 주소를 페이지의 va에 복제
+    struct hash_elem *e = hash_find(&spt->spt_hash, &key.hash_elem);  // spt hash 테이블에서 hash_elem과 같은 hash를 갖는 페이지를 찾아서 return
 
     return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
 }
@@ -97,57 +185,440 @@ bool spt_insert_page(struct supplemental_page_table *spt UNUSED, struct page *pa
 
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page) {
     hash_delete(&thread_current()->spt.spt_hash, &page->hash_elem);
+    if (page->locked)  /** Project 3: Mlock - frame 쪽 count는 destroy가 frame_unlink에서 줄인다. */
+        spt->locked_pages--;
     vm_dealloc_page(page);
     return true;
 }
 
-/** Project 3: Memory Management - 제거될 구조체 프레임을 가져옵니다. */
+/* PAGE를 FRAME의 rmap에 넣는다. frame_lock을 잡은 상태로 호출 */
+static void frame_link(struct frame *frame, struct page *page) {
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+
+    list_push_back(&frame->rmap, &page->rmap_elem);
+    frame->cnt++;
+    if (page->locked && frame->locked++ == 0)  // COW나 KSM으로 frame이 바뀌어도 mlock이 따라간다.
+        locked_frames++;
+    if (frame->page == NULL)
+        frame->page = page;
+    page->frame = frame;
+}
+
+/** Project 3: Reverse Map - PAGE를 FRAME에 연결한다. PTE는 호출한 쪽에서 설정 */
+static void vm_frame_map(struct frame *frame, struct page *page) {
+    lock_acquire(&frame_lock);
+    frame_link(frame, page);
+    lock_release(&frame_lock);
+}
+
+/* FRAME의 내용이 바뀌므로 ksm_table에서 뺀다. */
+static void ksm_forget(struct frame *frame) {
+    if (frame->ksm_listed) {
+        list_remove(&frame->ksm_elem);
+        frame->ksm_listed = false;
+    }
+    frame->ksm_hash = 0;
+}
+
+/* FRAME이 더 이상 파일의 그 page를 담지 않으므로 text_table에서 뺀다. */
+static void text_forget(struct frame *frame) {
+    if (frame->text_inode != NULL) {
+        list_remove(&frame->text_elem);
+        frame->text_inode = NULL;
+    }
+}
+
+/* FRAME을 frame table에서 뺀다. 가리키고 있던 clock hand와 ksm cursor는 다음으로 넘긴다. */
+static void frame_table_remove(struct frame *frame) {
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+
+    if (clock_hand == &frame->frame_elem)
+        clock_hand = list_next(clock_hand);
+    if (ksm_cursor == &frame->frame_elem)
+        ksm_cursor = list_next(ksm_cursor);
+    ksm_forget(frame);
+    text_forget(frame);
+    list_remove(&frame->frame_elem);
+}
+
+/* PAGE를 frame에서 떼어낸다. 마지막 mapping이었으면 frame table에서 뺀 frame을 리턴하고,
+ * 호출한 쪽이 lock을 놓은 뒤 해제한다. frame_lock을 잡은 상태로 호출 */
+static struct frame *frame_unlink(struct page *page) {
+    struct frame *frame = page->frame;
+
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+
+    if (frame == NULL)
+        return NULL;
+
+    list_remove(&page->rmap_elem);
+    pml4_clear_page(page->pml4, page->va);
+    page->frame = NULL;
+    if (page->locked && --frame->locked == 0)
+        locked_frames--;
+
+    if (--frame->cnt > 0) {
+        if (frame->page == page)
+            frame->page = list_entry(list_front(&frame->rmap), struct page, rmap_elem);
+        return NULL;
+    }
+
+    frame_table_remove(frame);
+    return frame;
+}
+
+/** Project 3: Reverse Map - PAGE의 mapping을 없앤다. 마지막 mapping이었으면 frame도 해제 */
+void vm_frame_unmap(struct page *page) {
+    lock_acquire(&frame_lock);
+    struct frame *frame = frame_unlink(page);  // evict와 겹치지 않도록 lock을 잡은 뒤에 읽는다.
+    lock_release(&frame_lock);
+
+    if (frame != NULL) {
+        palloc_free_page(frame->kva);
+        free(frame);
+    }
+}
+
+/** Project 3: Reverse Map - swap_out에서 호출. FRAME을 매핑한 모든 process에서 떼어낸다.
+ * Frame 자체는 frame table에 남아 재사용된다. */
+void vm_frame_unmap_all(struct frame *frame) {
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+
+    while (!list_empty(&frame->rmap)) {
+        struct page *page = list_entry(list_pop_front(&frame->rmap), struct page, rmap_elem);
+        pml4_clear_page(page->pml4, page->va);
+        page->frame = NULL;
+    }
+    frame->cnt = 0;
+    frame->page = NULL;
+    ksm_forget(frame);  // 다른 page의 내용으로 채워진다.
+    text_forget(frame);
+}
+
+/* FRAME의 mapping 중 하나라도 accessed bit가 켜져 있으면 true. 보면서 모두 지운다. */
+static bool vm_frame_accessed(struct frame *frame) {
+    bool accessed = false;
+    struct list_elem *e;
+
+    for (e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e)) {
+        struct page *page = list_entry(e, struct page, rmap_elem);
+        if (pml4_is_accessed(page->pml4, page->va)) {
+            accessed = true;
+            pml4_set_accessed(page->pml4, page->va, false);
+        }
+    }
+    return accessed;
+}
+
+/** Project 3: Reverse Map - FRAME의 mapping 중 하나라도 dirty면 true. 보면서 모두 지운다. */
+bool vm_frame_dirty(struct frame *frame) {
+    bool dirty = false;
+    struct list_elem *e;
+
+    for (e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e)) {
+        struct page *page = list_entry(e, struct page, rmap_elem);
+        if (pml4_is_dirty(page->pml4, page->va)) {
+            dirty = true;
+            pml4_set_dirty(page->pml4, page->va, false);
+        }
+    }
+    return dirty;
+}
+
+/** Project 3: Clustered Writeback - PAGE가 frame에 있고 dirty면 dirty bit를 지우고 frame을 pin한 뒤 true.
+ * 파일에 다 쓴 뒤 호출한 쪽이 pinned를 푼다. 쓰는 동안 다시 write 되면 dirty bit가 다시 켜진다. */
+bool vm_frame_pin_dirty(struct page *page) {
+    bool dirty = false;
+
+    lock_acquire(&frame_lock);  // evict와 겹치면 page->frame이 사라질 수 있다.
+    if (page->frame != NULL && !page->frame->pinned && vm_frame_dirty(page->frame)) {
+        page->frame->pinned = true;
+        dirty = true;
+    }
+    lock_release(&frame_lock);
+
+    return dirty;
+}
+
+/** Project 3: Clock - 제거될 구조체 프레임을 가져옵니다.
+ * 지난번 멈춘 곳부터 돌면서 frame을 매핑한 모든 pml4의 accessed bit를 본다.
+ * 한 바퀴 도는 동안 accessed bit를 모두 지우므로 늦어도 두 바퀴 안에 victim이 나온다.
+ * 두 바퀴를 돌아도 없으면 모든 frame이 pinned거나 mlock 된 것이므로 NULL */
 static struct frame *vm_get_victim(void) {
-    struct frame *victim = NULL;
     /* TODO: The policy for eviction is up to you. */
-    struct thread *curr = thread_current();
+    ASSERT(lock_held_by_current_thread(&frame_lock));
 
-    // Second Chance 방식으로 결정
-    struct list_elem *e = list_begin(&frame_table);
-    for (e; e != list_end(&frame_table); e = list_next(e)) {
-        victim = list_entry(e, struct frame, frame_elem);
-        if (pml4_is_accessed(curr->pml4, victim->page->va))
-            pml4_set_accessed(curr->pml4, victim->page->va, false);  // pml4가 최근에 사용됐다면 기회를 한번 더 준다.
-        else
-            return victim;
+    for (size_t scan = 2 * list_size(&frame_table); scan > 0; scan--) {
+        if (clock_hand == NULL || clock_hand == list_end(&frame_table))
+            clock_hand = list_begin(&frame_table);
+
+        struct frame *frame = list_entry(clock_hand, struct frame, frame_elem);
+        clock_hand = list_next(clock_hand);
+
+        if (frame->pinned || frame->locked > 0)  /** Project 3: Mlock - mlock 된 page는 evict 하지 않는다. */
+            continue;
+
+        if (frame->cnt == 0)  // 비어 있는 frame은 바로 재사용
+            return frame;
+
+        if (!vm_frame_accessed(frame))  // 최근에 사용됐다면 기회를 한번 더 준다.
+            return frame;
     }
+    return NULL;
+}
+
+/** Project 3: Swap Cluster - VICTIM과 함께 swap out할 같은 process의 anon frame들을 clock hand 뒤에서 모은다.
+ * 모은 frame은 pinned 상태로 CLUSTER에 담기고, CLUSTER[0]은 VICTIM이다. 모은 개수를 리턴 */
+static size_t vm_gather_victims(struct frame *victim, struct frame **cluster) {
+    size_t cnt = 0, scanned;
+
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+
+    victim->pinned = true;
+    cluster[cnt++] = victim;
+
+    for (scanned = 0; scanned < SWAP_CLUSTER_SCAN && cnt < SWAP_CLUSTER; scanned++) {
+        if (clock_hand == NULL || clock_hand == list_end(&frame_table))
+            clock_hand = list_begin(&frame_table);
+
+        struct frame *frame = list_entry(clock_hand, struct frame, frame_elem);
+        clock_hand = list_next(clock_hand);
 
-    return list_entry(list_begin(&frame_table), struct frame, frame_elem);
+        /* 같은 process의 page만 모아야 인접한 slot에 놓였을 때 read-ahead로 함께 돌아온다. */
+        if (frame->pinned || frame->locked > 0 || frame->page == NULL ||
+            VM_TYPE(frame->page->operations->type) != VM_ANON || frame->page->spt != victim->page->spt)
+            continue;
+
+        if (vm_frame_accessed(frame))  // clock과 같이 최근에 쓴 frame은 건너뛴다.
+            continue;
+
+        frame->pinned = true;
+        cluster[cnt++] = frame;
+    }
+    return cnt;
 }
 
-/** Project 3: Memory Management - 한 페이지를 제거하고 해당 프레임을 반환합니다. 오류가 발생하면 NULL을 반환합니다.*/
+/* Swap out이 끝난 빈 FRAME을 frame table에서 빼고 user pool로 돌려준다. */
+static void vm_free_frame(struct frame *frame) {
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+    ASSERT(frame->cnt == 0);
+
+    frame_table_remove(frame);
+
+    palloc_free_page(frame->kva);
+    free(frame);
+}
+
+/* Victim을 골라 swap out 한다. Victim이 anon page면 차가운 anon frame을 몇 개 더 모아 인접한 slot에 한 번에 쓰고,
+ * 나머지 frame은 user pool로 돌려준다. 비워진 victim을 pinned 상태로 리턴. Victim이 없으면 NULL.
+ * frame_lock을 잡은 상태로 호출 */
+static struct frame *vm_reclaim_frame(void) {
+    struct frame *cluster[SWAP_CLUSTER];
+    size_t cnt, i;
+
+    struct frame *victim = vm_get_victim();
+    if (victim == NULL)
+        return NULL;
+    if (victim->page && VM_TYPE(victim->page->operations->type) == VM_ANON) {
+        cnt = vm_gather_victims(victim, cluster);
+
+        if (cnt > 1 && anon_swap_out_cluster(cluster, cnt)) {
+            for (i = 1; i < cnt; i++)
+                vm_free_frame(cluster[i]);
+        } else {
+            for (i = 1; i < cnt; i++)
+                cluster[i]->pinned = false;
+            if (victim->page)  // clean page는 이미 떨어졌을 수 있다.
+                swap_out(victim->page);  // 모든 mapping이 함께 떨어진다.
+        }
+    } else if (victim->page)
+        swap_out(victim->page);
+
+    victim->pinned = true;  // 새 page를 채울 때까지 다시 고르지 않도록
+    return victim;
+}
+
+/** Project 3: Memory Management - 한 페이지를 제거하고 해당 프레임을 반환합니다. 오류가 발생하면 NULL을 반환합니다. */
 static struct frame *vm_evict_frame(void) {
-    struct frame *victim UNUSED = vm_get_victim();
+    lock_acquire(&frame_lock);
+    struct frame *victim UNUSED = vm_reclaim_frame();
     /* TODO: swap out the victim and return the evicted frame. */
-    if (victim->page)
-        swap_out(victim->page);
+    lock_release(&frame_lock);
 
+    if (victim == NULL)
+        return NULL;
+    memset(victim->kva, 0, PGSIZE);  // 이전 owner의 data가 보이지 않도록 PAL_ZERO와 같게 만든다.
     return victim;
 }
 
+/** Project 3: Kswapd - user pool의 빈 page가 kswapd_low 아래로 내려가면 깨어나서
+ * kswapd_high가 될 때까지 frame을 evict 해서 돌려준다. Fault 난 thread가 직접 evict 하는 일을 줄인다. */
+static void kswapd(void *aux UNUSED) {
+    while (true) {
+        sema_down(&kswapd_sema);
+
+        while (palloc_user_free_cnt() < kswapd_high) {
+            lock_acquire(&frame_lock);
+            if (list_empty(&frame_table)) {
+                lock_release(&frame_lock);
+                break;
+            }
+
+            struct frame *victim = vm_reclaim_frame();
+            bool freed = victim != NULL && victim->cnt == 0;  // swap이 가득 차거나 모두 mlock 되면 evict 하지 못한다.
+            if (freed)
+                vm_free_frame(victim);
+            else if (victim != NULL)
+                victim->pinned = false;
+            lock_release(&frame_lock);
+
+            if (!freed)
+                break;
+        }
+
+        kswapd_awake = false;
+    }
+}
+
+/* 빈 page가 low watermark 아래면 kswapd를 깨운다. */
+static void kswapd_wakeup(void) {
+    if (palloc_user_free_cnt() < kswapd_low && !kswapd_awake) {
+        kswapd_awake = true;
+        sema_up(&kswapd_sema);
+    }
+}
+
+/* User pool의 KVA를 담는 pinned frame을 만들어 frame table에 넣는다. */
+static struct frame *vm_new_frame(void *kva) {
+    struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
+    ASSERT(frame != NULL);
+
+    frame->kva = kva;
+    frame->page = NULL;
+    list_init(&frame->rmap);
+    frame->cnt = 0;
+    frame->pinned = true;
+    frame->locked = 0;
+    frame->ksm_hash = 0;
+    frame->ksm_listed = false;
+    frame->ksm_merged = false;
+    frame->text_inode = NULL;
+
+    lock_acquire(&frame_lock);
+    list_push_back(&frame_table, &frame->frame_elem);  // frame table에 추가
+    lock_release(&frame_lock);
+
+    return frame;
+}
+
 /** Project 3: Memory Management - palloc()을 실행하고 프레임을 가져옵니다. 사용 가능한 페이지가 없으면 해당 페이지를 제거하고 반환합니다.
- *  이는 항상 유효한 주소를 반환합니다. 즉, 사용자 풀 메모리가 가득 찬 경우 이 함수는 사용 가능한 메모리 공간을 확보하기 위해 프레임을 제거합니다.*/
+ *  사용자 풀 메모리가 가득 찬 경우 이 함수는 사용 가능한 메모리 공간을 확보하기 위해 프레임을 제거합니다.
+ *  모든 frame이 pinned거나 mlock 되어 제거할 수 없으면 NULL을 반환합니다.
+ *  돌려받은 frame은 pinned 상태이므로 내용을 채운 뒤 pinned를 풀어야 한다. */
 static struct frame *vm_get_frame(void) {
     /* TODO: Fill this function. */
-    struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
-    ASSERT(frame != NULL);
+    void *kva = palloc_get_page(PAL_USER | PAL_ZERO);  // 유저 풀(실제 메모리)에서 페이지를 할당 받는다.
+    kswapd_wakeup();
+    if (kva == NULL)
+        return vm_evict_frame();  // Swap Out 수행
 
-    frame->kva = palloc_get_page(PAL_USER | PAL_ZERO);  // 유저 풀(실제 메모리)에서 페이지를 할당 받는다.
+    return vm_new_frame(kva);
+}
 
-    if (frame->kva == NULL)
-        frame = vm_evict_frame();  // Swap Out 수행
-    else
-        list_push_back(&frame_table, &frame->frame_elem);  // frame table에 추가
+/* FROM을 매핑한 page들을 모두 TO로 옮긴다. 합친 frame은 모든 mapping이 read-only라서
+ * 첫 write는 vm_handle_wp에서 복사된다. frame_lock을 잡은 상태로 호출 */
+static void ksm_merge(struct frame *from, struct frame *to) {
+    while (!list_empty(&from->rmap)) {
+        struct page *page = list_entry(list_pop_front(&from->rmap), struct page, rmap_elem);
+        bool dirty = pml4_is_dirty(page->pml4, page->va);
 
-    frame->page = NULL;
-    ASSERT(frame->page == NULL);
+        pml4_set_page(page->pml4, page->va, to->kva, false);
+        pml4_set_dirty(page->pml4, page->va, dirty);  // swap cache가 clean으로 착각하지 않도록
+        frame_link(to, page);
+    }
+    from->cnt = 0;
+    from->page = NULL;
 
-    return frame;
+    if (!to->ksm_merged) {
+        to->ksm_merged = true;
+        ksm_shared++;
+    }
+    ksm_saved++;
+    vm_free_frame(from);
+}
+
+/* FRAME의 모든 mapping을 read-only로 바꾼다. 비교하는 동안 내용이 바뀌지 않게 한다. */
+static void ksm_write_protect(struct frame *frame) {
+    struct list_elem *e;
+
+    for (e = list_begin(&frame->rmap); e != list_end(&frame->rmap); e = list_next(e)) {
+        struct page *page = list_entry(e, struct page, rmap_elem);
+        pml4_set_writable(page->pml4, page->va, false);
+    }
+}
+
+/* FRAME 하나를 검사한다. 내용이 같은 안정된 frame이 있으면 합친다. frame_lock을 잡은 상태로 호출 */
+static void ksm_scan_frame(struct frame *frame) {
+    if (frame->pinned || frame->locked > 0 || frame->page == NULL || VM_TYPE(frame->page->operations->type) != VM_ANON)
+        return;
+    if (pml4_is_large_page(frame->page->pml4, frame->page->va))  // 합치려면 2MB page를 나눠야 한다.
+        return;
+
+    uint64_t hash = hash_bytes(frame->kva, PGSIZE);
+    if (hash != frame->ksm_hash) {  // 지난 scan 이후 바뀐 frame은 아직 후보가 아니다.
+        ksm_forget(frame);
+        frame->ksm_hash = hash;
+        return;
+    }
+    if (frame->ksm_listed)
+        return;
+
+    struct list *bucket = &ksm_table[hash % KSM_BUCKETS];
+    struct list_elem *e;
+
+    for (e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
+        struct frame *stable = list_entry(e, struct frame, ksm_elem);
+
+        if (stable->ksm_hash != hash || stable->pinned || stable->page == NULL)
+            continue;
+
+        ksm_write_protect(stable);
+        ksm_write_protect(frame);
+        if (memcmp(stable->kva, frame->kva, PGSIZE) == 0) {
+            ksm_merge(frame, stable);
+            return;
+        }
+    }
+
+    list_push_back(bucket, &frame->ksm_elem);
+    frame->ksm_listed = true;
+}
+
+/** Project 3: KSM - 가장 낮은 priority로 frame table을 돌면서 같은 내용의 anon frame을 합친다.
+ * KSM_INTERVAL마다 ksm_scan_pages개씩 검사한다. */
+static void ksmd(void *aux UNUSED) {
+    while (true) {
+        timer_sleep(KSM_INTERVAL);
+
+        lock_acquire(&frame_lock);
+        for (size_t i = 0; i < ksm_scan_pages && !list_empty(&frame_table); i++) {
+            if (ksm_cursor == NULL || ksm_cursor == list_end(&frame_table))
+                ksm_cursor = list_begin(&frame_table);
+
+            struct frame *frame = list_entry(ksm_cursor, struct frame, frame_elem);
+            ksm_cursor = list_next(ksm_cursor);
+            ksm_scan_frame(frame);  // 합쳐져서 해제될 수 있으므로 cursor를 먼저 옮긴다.
+        }
+        lock_release(&frame_lock);
+    }
+}
+
+/** Project 3: KSM - 종료 시 합친 결과 출력 */
+void ksm_print_stats(void) {
+    if (ksm_saved == 0)
+        return;
+
+    printf("KSM: %zu pages shared, %zu pages saved\n", ksm_shared, ksm_saved);
 }
 
 /* Growing the stack. */
@@ -163,26 +634,572 @@ static void vm_stack_growth(void *addr UNUSED) {
     }
 }
 
-/** Project 3: Copy On Write (Extra) - Handle the fault on write_protected page */
+/** Project 3: Copy On Write (Extra) - Handle the fault on write_protected page
+ * 혼자 쓰고 있는 frame이면 PTE를 writable로 바꾸기만 하고, 공유 중이면 새 frame에 복사한다. */
 bool vm_handle_wp(struct page *page UNUSED) {
-    if (!page->accessible)
+    if (page == NULL || !page->writable)
+        return false;
+
+    lock_acquire(&frame_lock);
+    if (page->frame != NULL && page->frame->cnt == 1) {
+        pml4_set_writable(page->pml4, page->va, true);  // dirty bit를 잃지 않도록 W bit만 켠다.
+        lock_release(&frame_lock);
+        return true;
+    }
+    lock_release(&frame_lock);
+
+    struct frame *frame = vm_get_frame();
+    if (frame == NULL)
         return false;
 
-    void *kva = page->frame->kva;
+    /* Zero page를 보고 있었거나 vm_get_frame이 공유 frame을 evict 했다면 swap_in으로 채우면 된다. */
+    lock_acquire(&frame_lock);
+    if (page->frame == NULL) {
+        lock_release(&frame_lock);
+        vm_frame_map(frame, page);
+        bool success = pml4_set_page(page->pml4, page->va, frame->kva, true) && swap_in(page, frame->kva);
+        frame->pinned = false;
+        return success;
+    }
 
-    page->frame->kva = palloc_get_page(PAL_USER | PAL_ZERO);
+    /* 복사하는 동안 evict나 ksmd가 원래 frame을 바꾸지 않도록 lock을 잡고 옮긴다. */
+    memcpy(frame->kva, page->frame->kva, PGSIZE);
+    struct frame *old = frame_unlink(page);
+    frame_link(frame, page);
+    lock_release(&frame_lock);
 
-    if (page->frame->kva == NULL)
-        page->frame = vm_evict_frame();  // Swap Out 수행
+    if (old != NULL) {  // 그 사이 다른 mapping이 모두 사라졌다.
+        palloc_free_page(old->kva);
+        free(old);
+    }
+    frame->pinned = false;
 
-    memcpy(page->frame->kva, kva, PGSIZE);
+    return pml4_set_page(page->pml4, page->va, frame->kva, true);
+}
+
+/** Project 3: Zero Page - 처음 접근할 때 0으로 채워지는 anon page(stack, BSS)면 true */
+static bool vm_is_zero_fill(struct page *page) {
+    return VM_TYPE(page->operations->type) == VM_UNINIT && VM_TYPE(page->uninit.type) == VM_ANON &&
+           page->uninit.init == NULL;
+}
+
+/** Project 3: THP - VA가 속한 2MB 영역이 VMA 안에서 모두 쓰기 가능한 zero-fill anon page이고 아직 아무것도 매핑되지 않았으면
+ * 2MB 정렬된 연속 frame을 받아 PDE 하나로 매핑한다. Fault, PTE, TLB entry가 모두 512분의 1로 준다.
+ * 4KB page마다 frame은 따로 있으므로 unmap, COW, evict는 mmu가 PDE를 나눈 뒤 4KB 단위로 진행된다. */
+static bool vm_claim_huge(struct vma *vma, void *va) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    uint64_t *pml4 = thread_current()->pml4;
+    void *base = (void *)((uint64_t)va & ~(LARGE_PGSIZE - 1));
+    uint64_t *pde = pde_walk(pml4, (uint64_t)base, false);
+    void *kva;
+    size_t i, done;
+
+    if (!vma->writable || base < vma->start || base + LARGE_PGSIZE > vma->end || !vma_zero_fill(vma, base))
+        return false;
+    if (pde != NULL && (*pde & PTE_P))
+        return false;
+    if (palloc_user_free_cnt() < THP_PAGES + kswapd_high)  // 2MB 때문에 다른 page가 evict 되지 않도록
+        return false;
+
+    for (i = 0; i < THP_PAGES; i++) {  // fork로 받은 page가 남아 있을 수 있다.
+        struct page *p = spt_find_page(spt, base + i * PGSIZE);
+        if (p != NULL && !vm_is_zero_fill(p))
+            return false;
+    }
+
+    kva = palloc_get_multiple_aligned(PAL_USER | PAL_ZERO, THP_PAGES, LARGE_PGSIZE);
+    if (kva == NULL)
+        return false;
+
+    /* 모든 page를 frame에 연결한 뒤에 PDE를 건다. 중간에 실패하면 되돌리고 4KB로 처리한다. */
+    bool success = true;
+    for (done = 0; success && done < THP_PAGES; done++) {
+        void *upage = base + done * PGSIZE;
+        struct page *p = spt_find_page(spt, upage);
+
+        if (p == NULL && (!vm_alloc_page(vma->type, upage, true) || (p = spt_find_page(spt, upage)) == NULL)) {
+            success = false;
+            break;
+        }
+
+        struct frame *frame = vm_new_frame(kva + done * PGSIZE);  // PDE를 걸 때까지 pinned
+        vm_frame_map(frame, p);
+        success = swap_in(p, frame->kva);  // uninit_initialize
+    }
+
+    if (success && pml4_set_large_page(pml4, base, kva, true)) {
+        for (i = 0; i < THP_PAGES; i++)
+            spt_find_page(spt, base + i * PGSIZE)->frame->pinned = false;
+        return true;
+    }
+
+    /* Frame을 받은 page는 frame과 함께 없앤다. 모두 zero-fill이므로 다음 fault 때 VMA에서 다시 만든다. */
+    for (i = 0; i < done; i++) {
+        struct page *p = spt_find_page(spt, base + i * PGSIZE);
+        vm_frame_unmap(p);  // 4KB 조각 하나씩 user pool로 돌아간다.
+        spt_remove_page(spt, p);
+    }
+    for (i = done; i < THP_PAGES; i++)
+        palloc_free_page(kva + i * PGSIZE);
+    return false;
+}
+
+/** Project 3: VMA - VMA 안의 VA에 파일에서 읽는 page를 만들고 바로 채운다.
+ * 파일 위치는 VMA에서 계산하고, aux는 채우는 동안에만 쓰이므로 stack에 둔다. */
+static bool vm_vma_claim(struct vma *vma, void *va) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    struct aux aux = {
+        .file = vma->file,
+        .offset = vma_page_offset(vma, va),
+        .page_read_bytes = vma_page_read_bytes(vma, va),
+    };
 
-    if (!pml4_set_page(thread_current()->pml4, page->va, page->frame->kva, page->accessible))
+    if (!vm_alloc_page_with_initializer(vma->type, va, vma->writable, lazy_load_segment, &aux))
         return false;
 
+    struct page *page = spt_find_page(spt, va);
+    if (vm_do_claim_page(page))
+        return true;
+
+    spt_remove_page(spt, page);  // aux가 사라지므로 남겨 두지 않고, 다음 fault에서 VMA를 보고 다시 만든다.
+    return false;
+}
+
+/** Project 3: Madvise - MADV_SEQUENTIAL인 VMA에서 이미 지나간 page들의 accessed bit를 지워
+ * clock이 먼저 가져가게 한다. 바로 뒤 FAULT_AROUND_PAGES는 아직 읽는 중일 수 있으므로 남긴다. */
+static void vm_drop_behind(struct vma *vma, void *va) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+
+    lock_acquire(&frame_lock);
+    for (size_t i = FAULT_AROUND_PAGES + 1; i <= FAULT_AROUND_PAGES + SEQ_READAHEAD_PAGES + 1; i++) {
+        if ((uint64_t)va < (uint64_t)vma->start + i * PGSIZE)
+            break;
+
+        struct page *page = spt_find_page(spt, va - i * PGSIZE);
+        if (page != NULL && page->frame != NULL)
+            vm_frame_accessed(page->frame);
+    }
+    lock_release(&frame_lock);
+}
+
+/** Project 3: Fault Around - 파일에서 읽는 VA가 fault 났을 때 같은 정렬된 범위 안에서
+ * 같은 VMA의 아직 만들지 않은 page들도 미리 읽어 매핑한다. 실행 파일의 text나 mmap을
+ * 순서대로 읽으면 fault가 FAULT_AROUND_PAGES분의 1로 준다.
+ * 미리 채운 page는 accessed bit가 꺼져 있어 쓰이지 않으면 clock이 먼저 가져간다.
+ *  Project 3: Madvise - MADV_RANDOM이면 미리 읽지 않고, MADV_SEQUENTIAL이면 앞쪽만 두 배로 읽는다. */
+static void vm_fault_around(struct vma *vma, void *va) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    uint64_t start = (uint64_t)va & ~(FAULT_AROUND_PAGES * PGSIZE - 1);
+    size_t cnt = FAULT_AROUND_PAGES;
+
+    if (vma->advice == MADV_RANDOM)  // 미리 읽어도 쓰이지 않는다.
+        return;
+    if (vma->advice == MADV_SEQUENTIAL) {
+        start = (uint64_t)va + PGSIZE;
+        cnt = SEQ_READAHEAD_PAGES;
+        vm_drop_behind(vma, va);
+    }
+
+    if (palloc_user_free_cnt() < cnt + kswapd_high)  // 미리 읽느라 다른 page를 evict 하지 않도록
+        return;
+
+    for (size_t i = 0; i < cnt; i++) {
+        void *near = (void *)(start + i * PGSIZE);
+
+        if (near == va || near < vma->start || near >= vma->end || vma_page_read_bytes(vma, near) == 0)
+            continue;
+        if (spt_find_page(spt, near) != NULL)
+            continue;
+
+        if (!vm_vma_claim(vma, near))  // 파일이 줄어들었으면 더 읽지 않는다.
+            break;
+    }
+}
+
+/* 미리 읽어 둔 내용으로 page를 채우는 aux. file_backed_initializer가 struct aux로 읽으므로 aux가 맨 앞에 있다. */
+struct populate_aux {
+    struct aux aux;
+    const uint8_t *data; /* page_read_bytes만큼 읽어 둔 내용 */
+};
+
+static bool populate_copy(struct page *page, void *aux) {
+    struct populate_aux *p = aux;
+
+    memcpy(page->frame->kva, p->data, p->aux.page_read_bytes);
+    memset(page->frame->kva + p->aux.page_read_bytes, 0, PGSIZE - p->aux.page_read_bytes);
+    return true;
+}
+
+/** Project 3: Populate - VMA의 [START, END)를 지금 채워 매핑한다. 파일 내용은 POPULATE_PAGES씩
+ * file_read_at 한 번으로 읽어 page마다 복사한다. 이미 있는 page는 건너뛰고, 실패하면 남은 page는 fault 때 채운다. */
+void vm_populate(struct vma *vma, void *start, void *end) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    uint8_t *buf = palloc_get_multiple(0, POPULATE_PAGES);
+
+    for (void *batch = start; batch < end; batch += POPULATE_PAGES * PGSIZE) {
+        void *stop = batch + POPULATE_PAGES * PGSIZE < end ? batch + POPULATE_PAGES * PGSIZE : end;
+        size_t len = 0;
+
+        for (void *va = batch; va < stop; va += PGSIZE)
+            len += vma_page_read_bytes(vma, va);
+
+        if (len > 0 && buf != NULL) {
+            lock_acquire(&filesys_lock);
+            off_t n = file_read_at(vma->file, buf, len, vma_page_offset(vma, batch));
+            lock_release(&filesys_lock);
+            if (n != (off_t)len)  // 파일이 줄어들었으면 fault 때 다시 읽게 둔다.
+                break;
+        }
+
+        for (void *va = batch; va < stop; va += PGSIZE) {
+            struct populate_aux aux = {
+                .aux = {vma->file, vma_page_offset(vma, va), vma_page_read_bytes(vma, va)},
+                .data = buf != NULL ? buf + (va - batch) : NULL,  // 꽉 찬 page 뒤에만 덜 찬 page가 온다.
+            };
+            bool success;
+
+            if (spt_find_page(spt, va) != NULL)
+                continue;
+
+            if (vma_zero_fill(vma, va))
+                success = vm_alloc_page(vma->type, va, vma->writable) && vm_claim_page(va);
+            else if (buf == NULL)  // 모을 buffer가 없으면 page마다 읽는다.
+                success = vm_vma_claim(vma, va);
+            else {
+                success = vm_alloc_page_with_initializer(vma->type, va, vma->writable, populate_copy, &aux);
+                if (success && !(success = vm_do_claim_page(spt_find_page(spt, va))))
+                    spt_remove_page(spt, spt_find_page(spt, va));
+            }
+
+            if (!success)
+                goto done;
+        }
+    }
+
+done:
+    if (buf != NULL)
+        palloc_free_multiple(buf, POPULATE_PAGES);
+}
+
+/** Project 3: Populate - -stack=N이면 첫 stack page 아래로 N page를 미리 매핑해 stack growth fault를 없앤다. */
+void vm_populate_stack(void) {
+    struct thread *curr = thread_current();
+
+    for (size_t i = 0; i < stack_prefault_pages && (uint64_t)curr->stack_bottom - PGSIZE >= STACK_LIMIT; i++) {
+        void *old = curr->stack_bottom;
+        vm_stack_growth(curr->stack_bottom - PGSIZE);
+        if (curr->stack_bottom == old)  // memory가 없으면 fault 때 늘린다.
+            break;
+    }
+}
+
+/** Project 3: VMA - VA가 page나 VMA 안에 있으면 true. WRITE면 쓰기 가능한지도 본다.
+ * System call이 user buffer를 검사할 때 page를 만들지 않고 쓴다. */
+bool vm_check_access(void *va, bool write) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    struct page *page = spt_find_page(spt, va);
+    struct vma *vma;
+
+    if (page != NULL)
+        return !write || page->writable;
+
+    vma = vma_find(spt, va);
+    return vma != NULL && (!write || vma->writable);
+}
+
+/* [ADDR, END)의 모든 page가 VMA나 spt에 있으면 true */
+static bool vm_range_mapped(void *addr, void *end) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+
+    for (void *va = addr; va < end; va += PGSIZE)
+        if (vma_find(spt, va) == NULL && spt_find_page(spt, va) == NULL)
+            return false;
     return true;
 }
 
+/** Project 3: Madvise - [ADDR, ADDR + LENGTH)를 어떻게 쓸지 알려 준다.
+ * NORMAL, RANDOM, SEQUENTIAL은 범위와 겹치는 VMA 전체의 fault around 방식을 바꾼다.
+ * WILLNEED는 빈 memory가 있는 만큼 지금 읽어 두고, DONTNEED는 page를 버려 다음 접근 때 VMA에서 다시 채운다.
+ * VMA 밖의 stack page는 다시 만들 수 없으므로 DONTNEED가 건드리지 않는다.
+ * mlock된 page가 범위에 있으면 Linux처럼 DONTNEED는 아무것도 버리지 않고 -1 */
+int vm_madvise(void *addr, size_t length, int advice) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    void *end = addr + ROUND_UP(length, PGSIZE);
+    struct vma *vma;
+    struct page *page;
+    void *va;
+
+    if (!vm_range_mapped(addr, end))
+        return -1;
+
+    switch (advice) {
+        case MADV_NORMAL:
+        case MADV_RANDOM:
+        case MADV_SEQUENTIAL:
+            for (va = addr; va < end; va += PGSIZE)
+                if ((vma = vma_find(spt, va)) != NULL)
+                    vma->advice = advice;
+            return 0;
+
+        case MADV_WILLNEED:
+            for (va = addr; va < end; va += PGSIZE) {
+                if ((vma = vma_find(spt, va)) == NULL)
+                    continue;
+                if (palloc_user_free_cnt() < kswapd_high)  // 미리 읽느라 다른 page를 evict 하지 않는다.
+                    break;
+
+                page = spt_find_page(spt, va);
+                if (page == NULL && !vma_zero_fill(vma, va))
+                    vm_vma_claim(vma, va);
+                else if (page != NULL && page->frame == NULL && !vm_is_zero_fill(page))
+                    vm_do_claim_page(page);  // evict된 page를 swap이나 파일에서 다시 읽는다.
+            }
+            return 0;
+
+        case MADV_DONTNEED:
+            for (va = addr; va < end; va += PGSIZE)
+                if ((page = spt_find_page(spt, va)) != NULL && page->locked)
+                    return -1;
+
+            for (va = addr; va < end;) {
+                if ((vma = vma_find(spt, va)) == NULL) {
+                    va += PGSIZE;
+                    continue;
+                }
+
+                void *stop = vma->end < end ? vma->end : end;
+                if (vma->mmap && vma->writable)  // 버리기 전에 모아서 써 둔다.
+                    file_writeback(vma, va, stop);
+
+                for (; va < stop; va += PGSIZE)
+                    if ((page = spt_find_page(spt, va)) != NULL)
+                        spt_remove_page(spt, page);  // swap slot도 destroy에서 돌려준다.
+            }
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+/** Project 3: Madvise - [ADDR, ADDR + LENGTH)의 page마다 frame에 올라와 있으면 VEC에 1, 아니면 0을 쓴다. */
+int vm_mincore(void *addr, size_t length, unsigned char *vec) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    void *end = addr + ROUND_UP(length, PGSIZE);
+
+    if (!vm_range_mapped(addr, end))
+        return -1;
+
+    for (void *va = addr; va < end; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        *vec++ = page != NULL && page->frame != NULL;
+    }
+    return 0;
+}
+
+/** Project 3: Mlock - PAGE를 frame에 올리고 evict 되지 않게 한다. 공유 중인 writable page는
+ * 첫 write에서 COW fault가 나지 않도록 미리 복사한다. MLOCK_LIMIT이나 전체 locked_frame_limit을 넘으면 false */
+static bool vm_lock_page(struct page *page) {
+    struct supplemental_page_table *spt = page->spt;
+
+    while (true) {
+        lock_acquire(&frame_lock);  // 확인한 뒤 lock 하기 전에 evict 되지 않도록
+        if (page->locked) {  // MCL_FUTURE면 아래 claim에서 이미 lock 됐을 수 있다.
+            lock_release(&frame_lock);
+            return true;
+        }
+        if (spt->locked_pages >= MLOCK_LIMIT) {
+            lock_release(&frame_lock);
+            return false;
+        }
+
+        struct frame *frame = page->frame;
+        if (frame != NULL && !(page->writable && frame->cnt > 1)) {
+            if (frame->locked == 0 && locked_frames >= locked_frame_limit) {
+                lock_release(&frame_lock);
+                return false;
+            }
+            page->locked = true;
+            if (frame->locked++ == 0)
+                locked_frames++;
+            spt->locked_pages++;
+            lock_release(&frame_lock);
+            return true;
+        }
+        lock_release(&frame_lock);
+
+        if (frame == NULL ? !vm_do_claim_page(page) : !vm_handle_wp(page))
+            return false;
+    }
+}
+
+/* PAGE의 mlock을 푼다. */
+static void vm_unlock_page(struct page *page) {
+    lock_acquire(&frame_lock);
+    if (page->locked) {
+        page->locked = false;
+        if (page->frame != NULL && --page->frame->locked == 0)
+            locked_frames--;
+        page->spt->locked_pages--;
+    }
+    lock_release(&frame_lock);
+}
+
+/* PAGE를 mlock 한다. 이번 호출에서 새로 lock 했으면 LOCKED[*CNT]에 남겨 실패할 때 되돌린다. */
+static bool vm_lock_new(struct page *page, struct page **locked, size_t *cnt) {
+    bool was_locked = page->locked;
+
+    if (!vm_lock_page(page))
+        return false;
+    if (!was_locked)
+        locked[(*cnt)++] = page;
+    return true;
+}
+
+/* vm_lock_new로 lock 한 CNT개의 page를 다시 푼다. */
+static void vm_unlock_new(struct page **locked, size_t cnt) {
+    while (cnt > 0)
+        vm_unlock_page(locked[--cnt]);
+}
+
+/* VA의 page를 mlock 한다. 아직 만들지 않은 page는 VMA를 보고 만든다. */
+static bool vm_lock_va(void *va, struct page **locked, size_t *cnt) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    struct page *page = spt_find_page(spt, va);
+    struct vma *vma;
+
+    if (page == NULL && (vma = vma_find(spt, va)) != NULL) {
+        if (vma_zero_fill(vma, va))
+            vm_alloc_page(vma->type, va, vma->writable);
+        else
+            vm_vma_claim(vma, va);
+        page = spt_find_page(spt, va);
+    }
+    return page != NULL && vm_lock_new(page, locked, cnt);
+}
+
+/** Project 3: Mlock - [ADDR, ADDR + LENGTH)를 모두 채우고 evict 되지 않게 한다.
+ * Mlock 된 page가 process마다 MLOCK_LIMIT을 넘게 되면 아무것도 하지 않고 -1.
+ * 중간에 frame이 없거나 전체 한도에 걸려도 이번에 lock 한 page를 되돌리고 -1 */
+int vm_mlock(void *addr, size_t length) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    void *end = addr + ROUND_UP(length, PGSIZE);
+    size_t need = 0;
+    void *va;
+
+    if (!vm_range_mapped(addr, end))
+        return -1;
+
+    for (va = addr; va < end; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        if (page == NULL || !page->locked)
+            need++;
+    }
+    if (spt->locked_pages + need > MLOCK_LIMIT)
+        return -1;
+
+    struct page **locked = need > 0 ? malloc(need * sizeof *locked) : NULL;  // 이번에 lock 한 page
+    size_t cnt = 0;
+    if (need > 0 && locked == NULL)
+        return -1;
+
+    for (va = addr; va < end; va += PGSIZE)
+        if (!vm_lock_va(va, locked, &cnt)) {
+            vm_unlock_new(locked, cnt);
+            free(locked);
+            return -1;
+        }
+    free(locked);
+    return 0;
+}
+
+/** Project 3: Mlock - [ADDR, ADDR + LENGTH)의 mlock을 푼다. */
+int vm_munlock(void *addr, size_t length) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    void *end = addr + ROUND_UP(length, PGSIZE);
+
+    if (!vm_range_mapped(addr, end))
+        return -1;
+
+    for (void *va = addr; va < end; va += PGSIZE) {
+        struct page *page = spt_find_page(spt, va);
+        if (page != NULL)
+            vm_unlock_page(page);
+    }
+    return 0;
+}
+
+/** Project 3: Mlock - MCL_CURRENT면 지금 mapping된 모든 page를, MCL_FUTURE면 앞으로 채우는 page를 mlock 한다.
+ * 지금 있는 page가 MLOCK_LIMIT을 넘거나 중간에 실패하면 이번에 lock 한 page를 되돌리고 -1 */
+int vm_mlockall(int flags) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    struct hash_iterator iter;
+    struct list_elem *e;
+    size_t need = 0;
+
+    if (flags == 0 || (flags & ~(MCL_CURRENT | MCL_FUTURE)))
+        return -1;
+
+    if (flags & MCL_CURRENT) {
+        hash_first(&iter, &spt->spt_hash);  // VMA 밖의 stack page
+        while (hash_next(&iter)) {
+            struct page *page = hash_entry(hash_cur(&iter), struct page, hash_elem);
+            if (!page->locked && vma_find(spt, page->va) == NULL)
+                need++;
+        }
+        for (e = list_begin(&spt->vmas); e != list_end(&spt->vmas); e = list_next(e)) {
+            struct vma *vma = list_entry(e, struct vma, elem);
+            for (void *va = vma->start; va < vma->end; va += PGSIZE) {
+                struct page *page = spt_find_page(spt, va);
+                if (page == NULL || !page->locked)
+                    need++;
+            }
+        }
+        if (spt->locked_pages + need > MLOCK_LIMIT)
+            return -1;
+
+        struct page **locked = need > 0 ? malloc(need * sizeof *locked) : NULL;  // 이번에 lock 한 page
+        size_t cnt = 0;
+        bool success = need == 0 || locked != NULL;
+
+        /* VMA page를 만들면 hash가 바뀌므로 stack page를 먼저 lock 한다. Stack page는 새로 만들지 않는다. */
+        hash_first(&iter, &spt->spt_hash);
+        while (success && hash_next(&iter)) {
+            struct page *page = hash_entry(hash_cur(&iter), struct page, hash_elem);
+            if (vma_find(spt, page->va) == NULL)
+                success = vm_lock_new(page, locked, &cnt);
+        }
+        for (e = list_begin(&spt->vmas); success && e != list_end(&spt->vmas); e = list_next(e)) {
+            struct vma *vma = list_entry(e, struct vma, elem);
+            for (void *va = vma->start; success && va < vma->end; va += PGSIZE)
+                success = vm_lock_va(va, locked, &cnt);
+        }
+
+        if (!success)
+            vm_unlock_new(locked, cnt);
+        free(locked);
+        if (!success)
+            return -1;
+    }
+
+    if (flags & MCL_FUTURE)
+        spt->lock_future = true;
+    return 0;
+}
+
+/** Project 3: Mlock - 모든 page의 mlock을 풀고 MCL_FUTURE도 끈다. */
+int vm_munlockall(void) {
+    struct supplemental_page_table *spt = &thread_current()->spt;
+    struct hash_iterator iter;
+
+    hash_first(&iter, &spt->spt_hash);
+    while (hash_next(&iter))
+        vm_unlock_page(hash_entry(hash_cur(&iter), struct page, hash_elem));
+
+    spt->lock_future = false;
+    return 0;
+}
+
 /** Project 3: Memory Management - Return true on success */
 bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED, bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
     struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
@@ -198,16 +1215,41 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED, bool us
 
     /** Project 3: Copy On Write (Extra) - 이전에 만들었던 페이지인데 swap out되어서 현재 spt에서 삭제하였을 때 stack_growth 대신 claim_page를 하기 위해 조건 분기 */
     if (!page) {
-        /** Project 3: Stack Growth - stack growth로 처리할 수 있는 경우 */
-        /* stack pointer 아래 8바이트는 페이지 폴트 발생 & addr 위치를 USER_STACK에서 1MB로 제한 */
-        void *stack_pointer = user ? f->rsp : thread_current()->stack_pointer;
-        if (stack_pointer - 8 <= addr && addr >= STACK_LIMIT && addr <= USER_STACK) {
-            vm_stack_growth(thread_current()->stack_bottom - PGSIZE);
+        /** Project 3: VMA - 처음 접근한 page는 VMA를 보고 만든다. */
+        struct vma *vma = vma_find(spt, addr);
+        void *va = pg_round_down(addr);
+
+        if (vma != NULL && !vma_zero_fill(vma, va)) {
+            if (!vm_vma_claim(vma, va))
+                return false;
+            vm_fault_around(vma, va);
             return true;
         }
-        return false;
+
+        if (vma != NULL) {
+            /** Project 3: THP - 큰 BSS처럼 2MB 전체가 빈 anon 영역이면 한 번에 2MB page로 매핑한다. */
+            if (vm_claim_huge(vma, va))
+                return true;
+            if (!vm_alloc_page(vma->type, va, vma->writable))
+                return false;
+            page = spt_find_page(spt, va);
+        } else {
+            /** Project 3: Stack Growth - stack growth로 처리할 수 있는 경우 */
+            /* stack pointer 아래 8바이트는 페이지 폴트 발생 & addr 위치를 USER_STACK에서 1MB로 제한 */
+            void *stack_pointer = user ? f->rsp : thread_current()->stack_pointer;
+            if (stack_pointer - 8 <= addr && addr >= STACK_LIMIT && addr <= USER_STACK) {
+                vm_stack_growth(thread_current()->stack_bottom - PGSIZE);
+                return true;
+            }
+            return false;
+        }
     }
 
+    /** Project 3: Zero Page - 읽기만 하는 동안은 frame 없이 zero page를 read-only로 매핑한다.
+     * 첫 write는 write protect fault가 되어 vm_handle_wp에서 frame을 할당한다. */
+    if (!write && vm_is_zero_fill(page))
+        return pml4_set_page(page->pml4, page->va, zero_page, false);
+
     return vm_do_claim_page(page);  // demand page 수행
 }
 
@@ -218,63 +1260,142 @@ void vm_dealloc_page(struct page *page) {
     free(page);
 }
 
-/** Project 3: Copy On Write (Extra) - VA에 할당된 페이지를 복제. */
-static bool vm_copy_claim_page(struct supplemental_page_table *dst, void *va, void *kva, bool writable) {
-    struct page *page = spt_find_page(dst, va);
+/** Project 3: Copy On Write (Extra) - fork된 PAGE가 SRC의 내용을 복사 없이 같이 쓰게 한다.
+ * Frame에 올라와 있으면 frame을 공유하고 부모와 자식 모두 read-only로 매핑한다.
+ * Anon page는 swap slot도 공유하고, frame이 없는 file page는 나중에 파일에서 읽는다. */
+static bool vm_copy_share_page(struct page *page, struct page *src) {
+    bool success = true;
+
+    lock_acquire(&frame_lock);  // evict와 겹치면 src->frame이 사라질 수 있다.
+    if (src->frame != NULL) {
+        frame_link(src->frame, page);
+        pml4_set_writable(src->pml4, src->va, false);
+        success = pml4_set_page(page->pml4, page->va, src->frame->kva, false);
+    }
+    if (VM_TYPE(src->operations->type) == VM_ANON)  // swap cache에 남아 있는 slot도 같이 가리킨다.
+        anon_share_slot(page, src);
+    lock_release(&frame_lock);
+
+    return success;
+}
+
+/** Project 3: Memory Management - VA에 할당된 페이지를 요청하세요. */
+bool vm_claim_page(void *va UNUSED) {
+    /* TODO: Fill this function */
+    struct page *page = spt_find_page(&thread_current()->spt, va);
 
     if (page == NULL)
         return false;
 
-    struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
+    return vm_do_claim_page(page);
+}
 
-    if (!frame)
+/* PAGE가 실행 파일의 read-only page면 파일에서의 위치를 채우고 true */
+static bool text_key(struct page *page, struct inode **inode, off_t *ofs, size_t *len) {
+    struct aux *aux;
+
+    if (VM_TYPE(page->operations->type) == VM_UNINIT && (page->uninit.type & VM_MARKER_1))
+        aux = page->uninit.aux;
+    else if (VM_TYPE(page->operations->type) == VM_FILE && page->file.text)
+        aux = (struct aux *)&page->file;  // file_page는 aux와 같은 모양이다.
+    else
         return false;
 
-    /* Set links */
-    page->accessible = writable;  // 접근 권한 설정
-    frame->page = page;
-    page->frame = frame;
-    frame->kva = kva;
+    *inode = file_get_inode(aux->file);
+    *ofs = aux->offset;
+    *len = aux->page_read_bytes;
+    return true;
+}
 
-    if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, false)) {
-        free(frame);
-        return false;
-    }
+static struct list *text_bucket(struct inode *inode, off_t ofs) {
+    return &text_table[((uint64_t)inode / sizeof(void *) + ofs / PGSIZE) % TEXT_BUCKETS];
+}
 
-    list_push_back(&frame_table, &frame->frame_elem);  // frame table에 추가
+/* 파일 위치에 해당하는 frame. 없으면 NULL. frame_lock을 잡은 상태로 호출 */
+static struct frame *text_lookup(struct inode *inode, off_t ofs, size_t len) {
+    struct list *bucket = text_bucket(inode, ofs);
+    struct list_elem *e;
 
-    return swap_in(page, frame->kva);
+    for (e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
+        struct frame *frame = list_entry(e, struct frame, text_elem);
+        if (frame->text_inode == inode && frame->text_ofs == ofs && frame->text_len == len)
+            return frame;
+    }
+    return NULL;
 }
 
-/** Project 3: Memory Management - VA에 할당된 페이지를 요청하세요. */
-bool vm_claim_page(void *va UNUSED) {
-    /* TODO: Fill this function */
-    struct page *page = spt_find_page(&thread_current()->spt, va);
+/** Project 3: Shared Text - 다른 process가 이미 읽어 둔 같은 page가 있으면 PAGE를 그 frame에 read-only로 매핑한다.
+ * Frame은 rmap으로 refcount 되므로 마지막 process가 떼어낼 때 해제된다. */
+static bool text_share(struct page *page, struct inode *inode, off_t ofs, size_t len) {
+    bool success = false;
 
-    if (page == NULL)
-        return false;
+    lock_acquire(&frame_lock);  // evict와 겹치면 frame이 사라질 수 있다.
+    struct frame *frame = text_lookup(inode, ofs, len);
+    if (frame != NULL && !frame->pinned) {  // 아직 채우는 중이면 따로 읽는다.
+        if (VM_TYPE(page->operations->type) == VM_UNINIT)  // 파일은 읽지 않고 file page로만 바꾼다.
+            page->uninit.page_initializer(page, page->uninit.type, frame->kva);
 
-    return vm_do_claim_page(page);
+        frame_link(frame, page);
+        success = pml4_set_page(page->pml4, page->va, frame->kva, false);
+        if (!success)
+            frame_unlink(page);  // 다른 mapping이 남아 있으므로 frame은 그대로
+    }
+    lock_release(&frame_lock);
+
+    return success;
+}
+
+/* PAGE를 막 읽어 온 FRAME을 text_table에 넣어 다른 process가 찾을 수 있게 한다. */
+static void text_insert(struct frame *frame, struct inode *inode, off_t ofs, size_t len) {
+    lock_acquire(&frame_lock);
+    if (frame->text_inode == NULL && text_lookup(inode, ofs, len) == NULL) {
+        frame->text_inode = inode;
+        frame->text_ofs = ofs;
+        frame->text_len = len;
+        list_push_back(text_bucket(inode, ofs), &frame->text_elem);
+    }
+    lock_release(&frame_lock);
 }
 
 /** Project 3: Memory Management - PAGE를 요청하고 mmu를 설정하십시오. */
 static bool vm_do_claim_page(struct page *page) {
-    struct frame *frame = vm_get_frame();
-
-    /* Set links */
-    frame->page = page;
-    page->frame = frame;
-
-    /* TODO: Insert page table entry to map page's VA to frame's PA. */
-    if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable))
-        return false;
+    struct inode *inode;
+    off_t ofs;
+    size_t len;
+    bool text = text_key(page, &inode, &ofs, &len);
+    bool success;
+
+    if (text && text_share(page, inode, ofs, len))
+        success = true;
+    else {
+        struct frame *frame = vm_get_frame();
+        if (frame == NULL)
+            return false;
+
+        /* Set links */
+        vm_frame_map(frame, page);
+
+        /* TODO: Insert page table entry to map page's VA to frame's PA. */
+        success = pml4_set_page(page->pml4, page->va, frame->kva, page->writable) && swap_in(page, frame->kva);  // uninit_initialize
+
+        if (success && text)
+            text_insert(frame, inode, ofs, len);
+        frame->pinned = false;
+    }
 
-    return swap_in(page, frame->kva);  // uninit_initialize
+    /** Project 3: Mlock - mlockall(MCL_FUTURE) 뒤에 채운 page는 한도 안에서 바로 mlock 한다. */
+    if (success && page->spt->lock_future)
+        vm_lock_page(page);
+    return success;
 }
 
 /* Initialize new supplemental page table */
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED) {
     hash_init(&spt->spt_hash, hash_func, less_func, NULL);
+    spt->swap_cursor = BITMAP_ERROR;
+    vma_init(spt);
+    spt->locked_pages = 0;
+    spt->lock_future = false;
 }
 
 /** Project 3: Anonymous Page - Copy supplemental page table from src to dst */
@@ -283,6 +1404,10 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
     struct page *dst_page;
     struct aux *aux;
 
+    /** Project 3: VMA - 아직 만들지 않은 page는 자식이 자기 VMA를 보고 만든다. */
+    if (!vma_copy(dst, src))
+        goto err;
+
     hash_first(&iter, &src->spt_hash);
 
     while (hash_next(&iter)) {
@@ -292,8 +1417,8 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
         bool writable = src_page->writable;
 
         switch (type) {
-            case VM_UNINIT:  // src 타입이 initialize 되지 않았을 경우
-                if (!vm_alloc_page_with_initializer(page_get_type(src_page), upage, writable, src_page->uninit.init, src_page->uninit.aux))
+            case VM_UNINIT:  // src 타입이 initialize 되지 않았을 경우. marker도 그대로 넘긴다.
+                if (!vm_alloc_page_with_initializer(src_page->uninit.type, upage, writable, src_page->uninit.init, src_page->uninit.aux))
                     goto err;
                 break;
 
@@ -301,12 +1426,16 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
                 if (!vm_alloc_page_with_initializer(type, upage, writable, NULL, &src_page->file))
                     goto err;
 
-                dst_page = spt_find_page(dst, upage);  // 대응하는 물리 메모리 데이터 복제
+                dst_page = spt_find_page(dst, upage);
                 if (!file_backed_initializer(dst_page, type, NULL))
                     goto err;
+                dst_page->file.text = src_page->file.text;
+                struct vma *vma = vma_find(dst, upage);
+                if (vma != NULL && vma->file != NULL)  // 부모가 먼저 끝나 파일을 닫아도 다시 읽을 수 있도록
+                    dst_page->file.file = vma->file;
 
-                dst_page->frame = src_page->frame;
-                if (!pml4_set_page(thread_current()->pml4, dst_page->va, src_page->frame->kva, src_page->writable))
+                /** Project 3: Copy On Write - file page도 read-only로 공유하고 write할 때 복사한다. */
+                if (!vm_copy_share_page(dst_page, src_page))
                     goto err;
 
                 break;
@@ -315,16 +1444,14 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED, st
                 if (!vm_alloc_page(type, upage, writable))  // UNINIT 페이지 생성 및 초기화
                     goto err;
 
-                // if (!vm_claim_page(upage))  // 물리 메모리와 매핑하고 initialize
-                //     goto err;
-
-                // struct page *dst_page = spt_find_page(dst, upage);  // 대응하는 물리 메모리 데이터 복제
-                // memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
-
                 /** Project 3: Copy On Write (Extra) - 메모리에 load된 데이터를 write하지 않는 이상 똑같은 메모리를 사용하는데
                  *  2개의 복사본을 만드는 것은 메모리가 낭비가 난다. 따라서 write 요청이 들어왔을 때만 해당 페이지에 대한 물리메모리를
-                 *  할당하고 맵핑하면 된다. */
-                if (!vm_copy_claim_page(dst, upage, src_page->frame->kva, writable))  // 물리 메모리와 매핑하고 initialize
+                 *  할당하고 맵핑하면 된다. swap out된 page는 slot을 공유하므로 fork 중에 disk I/O가 없다. */
+                dst_page = spt_find_page(dst, upage);
+                if (!anon_initializer(dst_page, type, NULL))
+                    goto err;
+
+                if (!vm_copy_share_page(dst_page, src_page))
                     goto err;
 
                 break;
@@ -342,5 +1469,16 @@ err:
 
 /* Free the resource hold by the supplemental page table */
 void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED) {
+    struct list_elem *e;
+
+    /** Project 3: Clustered Writeback - page마다 따로 쓰지 않도록 dirty mmap page를 VMA 단위로 모아서 먼저 쓴다. */
+    for (e = list_begin(&spt->vmas); e != list_end(&spt->vmas); e = list_next(e)) {
+        struct vma *vma = list_entry(e, struct vma, elem);
+        if (vma->mmap && vma->writable)
+            file_writeback(vma, vma->start, vma->end);
+    }
+
     hash_clear(&spt->spt_hash, hash_destructor);  // 해시 테이블의 모든 요소 제거
+    vma_kill(spt);                                // dirty mmap page를 다 쓴 뒤에 파일을 닫는다.
+    spt->locked_pages = 0;                        /** Project 3: Mlock - frame 쪽 count는 destroy에서 줄었다. */
 }
\ No newline at end of file
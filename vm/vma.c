@@ -0,0 +1,137 @@
+/* vma.c: Virtual memory areas of a process. */
+
+#include "vm/vma.h"
+
+#include <debug.h>
+
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+
+/** Project 3: VMA - SPT의 VMA 목록을 비운다. */
+void vma_init(struct supplemental_page_table *spt) {
+    list_init(&spt->vmas);
+    spt->vma_cache = NULL;
+}
+
+/* [START, END)가 SPT의 다른 VMA와 겹치면 true */
+static bool vma_overlaps(struct supplemental_page_table *spt, void *start, void *end) {
+    struct list_elem *e;
+
+    for (e = list_begin(&spt->vmas); e != list_end(&spt->vmas); e = list_next(e)) {
+        struct vma *vma = list_entry(e, struct vma, elem);
+        if (vma->start >= end)
+            break;
+        if (start < vma->end)
+            return true;
+    }
+    return false;
+}
+
+static bool vma_less(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
+    return list_entry(a, struct vma, elem)->start < list_entry(b, struct vma, elem)->start;
+}
+
+/** Project 3: VMA - [START, END)를 새 VMA로 등록한다. START부터 READ_BYTES는 FILE의 OFFSET부터 읽고
+ * 나머지는 0으로 채운다. FILE은 다시 열어서 VMA가 따로 가진다. 겹치거나 memory가 없으면 NULL */
+struct vma *vma_map(struct supplemental_page_table *spt, void *start, void *end, enum vm_type type, bool writable,
+                    struct file *file, off_t offset, size_t read_bytes, bool mmap) {
+    ASSERT(pg_ofs(start) == 0 && pg_ofs(end) == 0);
+
+    if (start >= end || vma_overlaps(spt, start, end))
+        return NULL;
+
+    struct vma *vma = malloc(sizeof *vma);
+    if (vma == NULL)
+        return NULL;
+
+    vma->file = NULL;
+    if (file != NULL && (vma->file = file_reopen(file)) == NULL) {
+        free(vma);
+        return NULL;
+    }
+
+    vma->start = start;
+    vma->end = end;
+    vma->type = type;
+    vma->writable = writable;
+    vma->offset = offset;
+    vma->read_bytes = read_bytes;
+    vma->mmap = mmap;
+    vma->advice = MADV_NORMAL;
+    list_insert_ordered(&spt->vmas, &vma->elem, vma_less, NULL);
+
+    return vma;
+}
+
+/** Project 3: VMA - VMA를 없애고 파일을 닫는다. 영역 안의 page는 호출한 쪽에서 먼저 정리한다. */
+void vma_unmap(struct supplemental_page_table *spt, struct vma *vma) {
+    if (spt->vma_cache == vma)
+        spt->vma_cache = NULL;
+
+    list_remove(&vma->elem);
+    file_close(vma->file);
+    free(vma);
+}
+
+/** Project 3: VMA - VA를 포함하는 VMA. 없으면 NULL.
+ * 같은 VMA 안에서 fault가 이어지는 경우가 많으므로 마지막으로 찾은 VMA를 먼저 본다. */
+struct vma *vma_find(struct supplemental_page_table *spt, const void *va) {
+    struct vma *vma = spt->vma_cache;
+    struct list_elem *e;
+
+    if (vma != NULL && vma->start <= va && va < vma->end)
+        return vma;
+
+    for (e = list_begin(&spt->vmas); e != list_end(&spt->vmas); e = list_next(e)) {
+        vma = list_entry(e, struct vma, elem);
+        if (vma->start > va)
+            break;
+        if (va < vma->end) {
+            spt->vma_cache = vma;
+            return vma;
+        }
+    }
+    return NULL;
+}
+
+/** Project 3: VMA - fork. SRC의 VMA들을 DST로 복사한다. 파일은 자식이 따로 다시 연다. */
+bool vma_copy(struct supplemental_page_table *dst, struct supplemental_page_table *src) {
+    struct list_elem *e;
+
+    for (e = list_begin(&src->vmas); e != list_end(&src->vmas); e = list_next(e)) {
+        struct vma *vma = list_entry(e, struct vma, elem);
+        struct vma *copy = vma_map(dst, vma->start, vma->end, vma->type, vma->writable, vma->file, vma->offset,
+                                   vma->read_bytes, vma->mmap);
+        if (copy == NULL)
+            return false;
+        copy->advice = vma->advice;
+    }
+    return true;
+}
+
+/** Project 3: VMA - 종료나 exec 때 모든 VMA를 없앤다. Page들이 먼저 정리된 뒤에 호출 */
+void vma_kill(struct supplemental_page_table *spt) {
+    while (!list_empty(&spt->vmas))
+        vma_unmap(spt, list_entry(list_front(&spt->vmas), struct vma, elem));
+}
+
+/* VMA 안의 page VA를 채울 파일 위치 */
+off_t vma_page_offset(const struct vma *vma, const void *va) {
+    return vma->offset + (va - vma->start);
+}
+
+/* VMA 안의 page VA에서 파일로부터 읽을 byte 수. 나머지는 0으로 채운다. */
+size_t vma_page_read_bytes(const struct vma *vma, const void *va) {
+    size_t ofs = va - vma->start;
+
+    if (ofs >= vma->read_bytes)
+        return 0;
+    return vma->read_bytes - ofs < PGSIZE ? vma->read_bytes - ofs : PGSIZE;
+}
+
+/* VA가 0으로만 채워지는 anon page면 true. 그 뒤의 page도 모두 그렇다. */
+bool vma_zero_fill(const struct vma *vma, const void *va) {
+    return VM_TYPE(vma->type) == VM_ANON && vma_page_read_bytes(vma, va) == 0;
+}
@@ -0,0 +1,305 @@
+/* zswap.c: Compressed in-memory tier in front of the swap disk. */
+
+#include "vm/zswap.h"
+
+#include <bitmap.h>
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/anon.h"
+
+/* 이보다 크게 압축되는 page는 저장하지 않는다. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+#define ZSWAP_CHUNKS (ZSWAP_PAGES * PGSIZE / ZSWAP_CHUNK)
+/* Arena 사용량이 HIGH(%)를 넘으면 zswapd가 오래된 entry를 LOW(%)까지 disk로 내린다. */
+#define ZSWAP_HIGH_PCT 75
+#define ZSWAP_LOW_PCT 50
+#define ZSWAP_INTERVAL (TIMER_FREQ / 10)
+
+/* LZ codec */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+
+/* 압축된 page 하나. */
+struct zswap_entry {
+    size_t slot;          /* Swap slot */
+    size_t chunk;         /* arena에서 시작 chunk */
+    size_t len;           /* 압축된 byte 수 */
+    struct list_elem elem; /* lru element */
+    bool on_lru;          /* writeback 중이거나 깨진 entry는 lru에서 빠진다. */
+    bool writeback;       /* zswapd가 lock 없이 disk에 쓰는 중 */
+};
+
+static uint8_t *arena;
+static struct bitmap *chunk_map;    /* 사용 중인 chunk */
+static size_t used_chunks;
+static struct zswap_entry **slot_map; /* slot -> entry. 없으면 NULL */
+static struct list lru;             /* 오래 저장된 entry가 앞 */
+static struct lock zswap_lock;      /* 위 모두와 lz_table, zswap_buf 보호. frame_lock 다음에 잡는다. */
+static uint8_t *zswap_buf;          /* 압축용 page */
+static struct condition writeback_done; /* writeback 중인 entry가 없어질 때 */
+static uint8_t *writeback_buf;      /* zswapd만 쓰는 page. lock 없이 disk에 쓰는 동안 내용을 들고 있다. */
+static uint16_t lz_table[1 << LZ_HASH_BITS]; /* 4 byte hash -> 위치 + 1 */
+
+static void zswapd(void *aux);
+
+/** Project 3: Zswap - SLOT_CNT개의 swap slot을 위한 압축 tier를 만든다. */
+void zswap_init(size_t slot_cnt) {
+    arena = palloc_get_multiple(PAL_ASSERT, ZSWAP_PAGES);
+    zswap_buf = palloc_get_page(PAL_ASSERT);
+    writeback_buf = palloc_get_page(PAL_ASSERT);
+    chunk_map = bitmap_create(ZSWAP_CHUNKS);
+    slot_map = calloc(slot_cnt, sizeof *slot_map);
+    if (chunk_map == NULL || slot_map == NULL)
+        PANIC("zswap: out of memory");
+
+    list_init(&lru);
+    lock_init(&zswap_lock);
+    cond_init(&writeback_done);
+    thread_create("zswapd", PRI_MIN, zswapd, NULL);
+}
+
+static uint32_t lz_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static unsigned lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* 15 이상의 길이를 255 단위로 이어 쓴다. */
+static uint8_t *lz_put_len(uint8_t *op, size_t len) {
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = len;
+    return op;
+}
+
+/* Literal LIT_LEN개와 OFFSET 뒤 MLEN byte의 match 하나를 쓴다. MLEN이 0이면 마지막 literal.
+ * OEND를 넘으면 NULL */
+static uint8_t *lz_emit(uint8_t *op, uint8_t *oend, const uint8_t *lit, size_t lit_len, size_t offset, size_t mlen) {
+    size_t ml = mlen ? mlen - LZ_MIN_MATCH : 0;
+    size_t need = 1 + lit_len + (mlen ? 2 : 0) + (lit_len >= 15 ? lit_len / 255 + 1 : 0) + (ml >= 15 ? ml / 255 + 1 : 0);
+
+    if (need > (size_t)(oend - op))
+        return NULL;
+
+    uint8_t *token = op++;
+    *token = (lit_len < 15 ? lit_len : 15) << 4 | (ml < 15 ? ml : 15);
+    if (lit_len >= 15)
+        op = lz_put_len(op, lit_len - 15);
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (mlen) {
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+        if (ml >= 15)
+            op = lz_put_len(op, ml - 15);
+    }
+    return op;
+}
+
+/* LZ4와 비슷한 형식으로 page SRC를 DST에 압축한다. 압축된 크기를 리턴하고,
+ * DST_MAX보다 커지면 0. zswap_lock을 잡은 상태로 호출 */
+static size_t lz_compress(const uint8_t *src, uint8_t *dst, size_t dst_max) {
+    const uint8_t *ip = src, *anchor = src, *end = src + PGSIZE;
+    uint8_t *op = dst, *oend = dst + dst_max;
+
+    memset(lz_table, 0, sizeof lz_table);
+    while (ip + LZ_MIN_MATCH <= end) {
+        uint32_t seq = lz_read32(ip);
+        unsigned h = lz_hash(seq);
+        const uint8_t *ref = lz_table[h] ? src + lz_table[h] - 1 : NULL;
+
+        lz_table[h] = ip - src + 1;
+        if (ref == NULL || lz_read32(ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        size_t mlen = LZ_MIN_MATCH;
+        while (ip + mlen < end && ref[mlen] == ip[mlen])
+            mlen++;
+
+        op = lz_emit(op, oend, anchor, ip - anchor, ip - ref, mlen);
+        if (op == NULL)
+            return 0;
+        ip += mlen;
+        anchor = ip;
+    }
+
+    op = lz_emit(op, oend, anchor, end - anchor, 0, 0);
+    return op != NULL ? (size_t)(op - dst) : 0;
+}
+
+static bool lz_get_len(const uint8_t **ip, const uint8_t *iend, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= iend)
+            return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+/* LEN byte의 SRC를 page DST로 푼다. 형식이 잘못되었으면 false */
+static bool lz_decompress(const uint8_t *src, size_t len, uint8_t *dst) {
+    const uint8_t *ip = src, *iend = src + len;
+    uint8_t *op = dst, *oend = dst + PGSIZE;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t lit = token >> 4, ml = token & 15, offset;
+
+        if (lit == 15 && !lz_get_len(&ip, iend, &lit))
+            return false;
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op))
+            return false;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (op == oend)  // 마지막 literal
+            return ip == iend;
+
+        if (iend - ip < 2)
+            return false;
+        offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        if (ml == 15 && !lz_get_len(&ip, iend, &ml))
+            return false;
+        ml += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || ml > (size_t)(oend - op))
+            return false;
+
+        for (size_t i = 0; i < ml; i++)  // 겹치는 match가 있으므로 한 byte씩
+            op[i] = op[i - offset];
+        op += ml;
+    }
+    return op == oend;
+}
+
+/* E를 없애고 chunk를 돌려준다. zswap_lock을 잡은 상태로 호출 */
+static void zswap_drop(struct zswap_entry *e) {
+    size_t chunks = DIV_ROUND_UP(e->len, ZSWAP_CHUNK);
+
+    if (e->on_lru)
+        list_remove(&e->elem);
+    bitmap_set_multiple(chunk_map, e->chunk, chunks, false);
+    used_chunks -= chunks;
+    slot_map[e->slot] = NULL;
+    free(e);
+}
+
+/** Project 3: Zswap - PAGE를 압축해 SLOT으로 저장한다.
+ * 잘 압축되지 않거나 arena가 가득 차면 false를 리턴하고, 호출한 쪽이 disk에 쓴다. */
+bool zswap_store(size_t slot, const void *page) {
+    struct zswap_entry *e = malloc(sizeof *e);
+    if (e == NULL)
+        return false;
+
+    lock_acquire(&zswap_lock);
+    ASSERT(slot_map[slot] == NULL);
+
+    size_t len = lz_compress(page, zswap_buf, ZSWAP_MAX_LEN);
+    size_t chunk = BITMAP_ERROR;
+    if (len > 0)
+        chunk = bitmap_scan_and_flip(chunk_map, 0, DIV_ROUND_UP(len, ZSWAP_CHUNK), false);
+
+    if (chunk == BITMAP_ERROR) {
+        lock_release(&zswap_lock);
+        free(e);
+        return false;
+    }
+
+    memcpy(arena + chunk * ZSWAP_CHUNK, zswap_buf, len);
+    e->slot = slot;
+    e->chunk = chunk;
+    e->len = len;
+    e->on_lru = true;
+    e->writeback = false;
+    list_push_back(&lru, &e->elem);
+    used_chunks += DIV_ROUND_UP(len, ZSWAP_CHUNK);
+    slot_map[slot] = e;
+    lock_release(&zswap_lock);
+
+    return true;
+}
+
+/** Project 3: Zswap - SLOT이 압축 tier에 있으면 PAGE로 푼다. 없으면 MISS, 압축본이 깨졌으면 CORRUPT.
+ * Writeback 중인 entry도 arena에 그대로 있으므로 풀 수 있다. */
+enum zswap_result zswap_load(size_t slot, void *page) {
+    enum zswap_result result = ZSWAP_HIT;
+
+    lock_acquire(&zswap_lock);
+    struct zswap_entry *e = slot_map[slot];
+    if (e == NULL)
+        result = ZSWAP_MISS;
+    else if (!lz_decompress(arena + e->chunk * ZSWAP_CHUNK, e->len, page)) {
+        printf("zswap: corrupted entry for slot %zu\n", slot);
+        result = ZSWAP_CORRUPT;
+    }
+    lock_release(&zswap_lock);
+
+    return result;
+}
+
+/** Project 3: Zswap - SLOT이 비워질 때 호출. 압축된 내용을 버린다.
+ * zswapd가 SLOT을 disk에 쓰는 중이면 끝날 때까지 기다려서, 비운 slot이 재사용된 뒤에 예전 내용이 덮어쓰지 않게 한다. */
+void zswap_invalidate(size_t slot) {
+    lock_acquire(&zswap_lock);
+    while (slot_map[slot] != NULL && slot_map[slot]->writeback)
+        cond_wait(&writeback_done, &zswap_lock);
+    if (slot_map[slot] != NULL)
+        zswap_drop(slot_map[slot]);
+    lock_release(&zswap_lock);
+}
+
+/** Project 3: Zswap - arena가 HIGH를 넘으면 가장 오래된 entry부터 disk slot에 써서 LOW까지 비운다.
+ * Disk에 쓰는 동안에는 lock을 놓는다. Entry를 writeback 중으로 표시해 두므로 그 사이 zswap_load는 arena에서 풀고,
+ * zswap_invalidate는 쓰기가 끝날 때까지 기다린다. */
+static void zswapd(void *aux UNUSED) {
+    while (true) {
+        timer_sleep(ZSWAP_INTERVAL);
+
+        if (used_chunks * 100 < ZSWAP_CHUNKS * ZSWAP_HIGH_PCT)
+            continue;
+
+        while (true) {
+            lock_acquire(&zswap_lock);
+            if (used_chunks * 100 <= ZSWAP_CHUNKS * ZSWAP_LOW_PCT || list_empty(&lru)) {
+                lock_release(&zswap_lock);
+                break;
+            }
+
+            struct zswap_entry *e = list_entry(list_pop_front(&lru), struct zswap_entry, elem);
+            e->on_lru = false;
+            if (!lz_decompress(arena + e->chunk * ZSWAP_CHUNK, e->len, writeback_buf)) {
+                /* 깨진 entry는 disk로 내리지 않고 남겨 둔다. Swap in 할 때 실패한다. */
+                lock_release(&zswap_lock);
+                continue;
+            }
+            e->writeback = true;
+            lock_release(&zswap_lock);
+
+            anon_swap_write(e->slot, writeback_buf);
+
+            lock_acquire(&zswap_lock);
+            zswap_drop(e);
+            cond_broadcast(&writeback_done, &zswap_lock);
+            lock_release(&zswap_lock);
+        }
+    }
+}